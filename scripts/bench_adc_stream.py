@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure the sustained ADC stream rate seen by a websocket client.
+
+Subscribes to "/adc" for a while, counts the frames received and the blocks
+missing from the sequence numbers, and prints them next to the device side
+counters from /stats/adc.
+
+Example:
+    ./bench_adc_stream.py 192.0.2.1 --seconds 10
+"""
+
+import argparse
+import struct
+import time
+
+from bench_ws_deflate import http_get_json
+from ws_client import WebSocket
+
+HDR = struct.Struct("<IIIHH")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--seconds", type=float, default=10)
+    args = parser.parse_args()
+
+    ws = WebSocket(args.host, args.port, "/adc")
+    frames = 0
+    blocks = 0
+    lost = 0
+    last_seq = None
+    start = time.perf_counter()
+
+    while time.perf_counter() - start < args.seconds:
+        _, payload = ws.recv_message()
+        seq, _, rate, channels, count = HDR.unpack_from(payload)
+        if len(payload) != HDR.size + 2 * channels * count:
+            raise AssertionError(f"block {seq} has {len(payload)} bytes")
+
+        if last_seq is not None:
+            lost += seq - last_seq - 1
+        last_seq = seq
+        frames += count
+        blocks += 1
+
+    elapsed = time.perf_counter() - start
+    ws.close()
+
+    stats = http_get_json(args.host, args.port, "/stats/adc")
+    print(f"client: {blocks} blocks, {frames / elapsed:.0f} frames/s of {rate} configured,"
+          f" {lost} blocks lost, {ws.rx / elapsed / 1024:.1f} KiB/s")
+    print(f"device: {stats['sustained']} frames/s sampled, {stats['overruns']} overruns,"
+          f" {stats['errors']} errors")
+
+
+if __name__ == "__main__":
+    main()
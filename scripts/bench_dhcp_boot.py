@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure the time to the first HTTP response after boot, with and without a cached DHCP lease.
+
+Starts a native_sim build of overlay-dhcp.conf several times. The first
+boot runs on an erased flash and has to discover a lease, later boots
+find it in settings. For each boot the time from starting the process to
+the first answer on /uptime is printed, next to the device side uptimes
+from /stats/dhcp at which the address became usable and the lease bound.
+
+A DHCP server must hand out --host on the zeth interface, for instance:
+    dnsmasq -d -i zeth --dhcp-range=192.0.2.1,192.0.2.1,5m
+
+Example:
+    ./bench_dhcp_boot.py build/zephyr/zephyr.exe --host 192.0.2.1 --boots 4
+"""
+
+import argparse
+import socket
+import subprocess
+import time
+
+from bench_ws_deflate import http_get_json
+
+REQUEST = "GET /uptime HTTP/1.1\r\nHost: {host}\r\nConnection: close\r\n\r\n"
+
+
+def first_response(host, port, start, timeout):
+    """Poll /uptime until it answers, return the seconds since start"""
+    while time.perf_counter() - start < timeout:
+        try:
+            with socket.create_connection((host, port), timeout=0.2) as sock:
+                sock.sendall(REQUEST.format(host=host).encode())
+                if sock.recv(16).startswith(b"HTTP/1.1 200"):
+                    return time.perf_counter() - start
+        except OSError:
+            time.sleep(0.02)
+    raise TimeoutError(f"no answer from {host}:{port} within {timeout} s")
+
+
+def boot(exe, flash, erase, host, port, timeout):
+    args = [exe, f"--flash={flash}"]
+    if erase:
+        args.append("--flash_erase")
+
+    start = time.perf_counter()
+    proc = subprocess.Popen(args, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        elapsed = first_response(host, port, start, timeout)
+        # Let the background DHCP exchange finish before reading its stats
+        deadline = time.perf_counter() + timeout
+        while (stats := http_get_json(host, port, "/stats/dhcp"))["bound_ms"] < 0:
+            if time.perf_counter() > deadline:
+                break
+            time.sleep(0.1)
+    finally:
+        proc.terminate()
+        proc.wait()
+
+    return elapsed, stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("exe", help="zephyr.exe built with overlay-dhcp.conf")
+    parser.add_argument("--host", default="192.0.2.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--flash", default="dhcp_boot_flash.bin")
+    parser.add_argument("--boots", type=int, default=4)
+    parser.add_argument("--timeout", type=float, default=60)
+    args = parser.parse_args()
+
+    print(f"{'boot':>4}  {'lease':>6}  {'first response ms':>17}  {'ready ms':>8}  {'bound ms':>8}")
+
+    for i in range(args.boots):
+        elapsed, stats = boot(args.exe, args.flash, i == 0, args.host, args.port, args.timeout)
+        lease = "cold" if i == 0 else "cached"
+        print(f"{i:>4}  {lease:>6}  {elapsed * 1000:>17.0f}  {stats['ready_ms']:>8}"
+              f"  {stats['bound_ms']:>8}")
+
+
+if __name__ == "__main__":
+    main()
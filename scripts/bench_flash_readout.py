@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure the read-out throughput of a flash partition and check Range requests.
+
+Downloads /flash/<partition> --count times and reports the throughput,
+then fetches a few byte ranges and compares them with the full download.
+The image must be built with CONFIG_NET_SAMPLE_AUTH_TOKEN set to --token.
+On native_sim the partitions live in the flash simulator, reached through
+the zeth tap interface.
+
+Example:
+    ./bench_flash_readout.py 192.0.2.1 --token diag --partition slot0_partition
+"""
+
+import argparse
+import http.client
+import time
+
+
+def get(host, port, path, token, headers=None):
+    conn = http.client.HTTPConnection(host, port, timeout=30)
+    conn.request("GET", path, headers={"Authorization": f"Bearer {token}", **(headers or {})})
+    resp = conn.getresponse()
+    body = resp.read()
+    conn.close()
+    return resp.status, resp.getheader("Content-Range"), body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--token", required=True)
+    parser.add_argument("--partition", default="slot0_partition")
+    parser.add_argument("--count", type=int, default=5)
+    args = parser.parse_args()
+
+    path = f"/flash/{args.partition}"
+
+    status, _, _ = get(args.host, args.port, path, "wrong")
+    print(f"wrong token: {status}")
+
+    image = None
+    for i in range(args.count):
+        start = time.perf_counter()
+        status, _, body = get(args.host, args.port, path, args.token)
+        elapsed = time.perf_counter() - start
+        if status != 200:
+            raise SystemExit(f"GET {path} failed with {status}")
+        if image is not None and body != image:
+            raise AssertionError("partition content changed between downloads")
+        image = body
+        print(f"{len(body)} bytes in {elapsed * 1000:.0f} ms, {len(body) / elapsed / 1024:.0f} KiB/s")
+
+    size = len(image)
+    for spec, first, last in ((f"bytes=0-{min(1023, size - 1)}", 0, min(1023, size - 1)),
+                              (f"bytes={size // 2}-", size // 2, size - 1),
+                              ("bytes=-100", max(size - 100, 0), size - 1)):
+        status, content_range, body = get(args.host, args.port, path, args.token, {"Range": spec})
+        ok = status == 206 and body == image[first:last + 1]
+        print(f"{spec:<20} {status} {content_range} {'ok' if ok else 'MISMATCH'}")
+
+    status, content_range, _ = get(args.host, args.port, path, args.token,
+                                   {"Range": f"bytes={size}-"})
+    print(f"{'past the end':<20} {status} {content_range}")
+
+
+if __name__ == "__main__":
+    main()
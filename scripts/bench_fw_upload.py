@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compare firmware upload throughput over websocket and plain POST.
+
+Uploads the same image twice, first over the windowed websocket channel
+("/upload_ws"), which keeps several acknowledged chunks in flight so flash
+programming overlaps the transfer, then as the body of a POST to "/upload".
+Both write slot1 and mark the image for a test boot. The image must be
+built with CONFIG_NET_SAMPLE_AUTH_TOKEN set to --token.
+
+Example:
+    ./bench_fw_upload.py 192.0.2.1 build/zephyr/zephyr.signed.bin --token diag
+"""
+
+import argparse
+import http.client
+import json
+import struct
+import time
+
+from ws_client import WebSocket
+
+
+def upload_ws(host, port, token, image, verbose):
+    ws = WebSocket(host, port, "/upload_ws", token=token)
+    start = time.perf_counter()
+
+    ws.send_message(b"S" + struct.pack("<I", len(image)))
+    reply = ws.recv_message()[1]
+    if reply[:1] != b"R":
+        raise RuntimeError(f"upload refused: {reply!r}")
+
+    window, chunk = struct.unpack("<HH", reply[1:5])
+    chunks = (len(image) + chunk - 1) // chunk
+    next_seq = 0
+    acked = 0
+
+    while acked < chunks:
+        while next_seq < chunks and next_seq - acked < window:
+            data = image[next_seq * chunk:(next_seq + 1) * chunk]
+            ws.send_message(b"D" + struct.pack("<I", next_seq) + data)
+            next_seq += 1
+
+        reply = ws.recv_message()[1]
+        if reply[:1] != b"A":
+            break
+
+        seq, written = struct.unpack("<II", reply[1:9])
+        acked = seq + 1
+        if verbose:
+            print(f"\r{written}/{len(image)}", end="", flush=True)
+
+    if reply[:1] == b"A":
+        ws.send_message(b"E")
+        reply = ws.recv_message()[1]
+
+    elapsed = time.perf_counter() - start
+    ws.close()
+    if verbose:
+        print()
+
+    status, written, ms = struct.unpack("<iII", reply[1:13])
+    if status != 0:
+        raise RuntimeError(f"websocket upload failed ({status}) after {written} bytes")
+
+    return written, elapsed, ms, window, chunk
+
+
+def upload_post(host, port, token, image):
+    conn = http.client.HTTPConnection(host, port, timeout=60)
+    start = time.perf_counter()
+
+    conn.request("POST", "/upload", body=image,
+                 headers={"Content-Type": "application/octet-stream",
+                          "Authorization": f"Bearer {token}"})
+    response = conn.getresponse()
+    body = response.read()
+    if response.status == 401:
+        raise RuntimeError("POST upload refused, wrong token")
+    result = json.loads(body)
+
+    elapsed = time.perf_counter() - start
+    conn.close()
+
+    if response.status != 200 or result["status"] != 0:
+        raise RuntimeError(f"POST upload failed: {result}")
+
+    return result["written"], elapsed, result["ms"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("image", type=argparse.FileType("rb"))
+    parser.add_argument("--token", required=True)
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("-v", "--verbose", action="store_true", help="show progress")
+    args = parser.parse_args()
+
+    image = args.image.read()
+
+    written, elapsed, ms, window, chunk = upload_ws(args.host, args.port, args.token, image,
+                                                args.verbose)
+    print(f"websocket: {written} bytes in {elapsed:.2f} s ({written / elapsed / 1024:.1f} KiB/s),"
+          f" device {ms} ms, window {window} x {chunk} B")
+
+    written, elapsed, ms = upload_post(args.host, args.port, args.token, image)
+    print(f"POST:      {written} bytes in {elapsed:.2f} s ({written / elapsed / 1024:.1f} KiB/s),"
+          f" device {ms} ms")
+
+
+if __name__ == "__main__":
+    main()
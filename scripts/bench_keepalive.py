@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compare /uptime polling throughput with and without persistent connections.
+
+Three modes are measured:
+  close      a new TCP connection per request ("Connection: close")
+  keepalive  requests sent one after another on a persistent connection
+  pipeline   requests written back-to-back before reading any response
+
+The server side reuse counters are read from /stats/http at the end.
+
+Example:
+    ./bench_keepalive.py 192.0.2.1 --requests 200 --depth 8
+"""
+
+import argparse
+import json
+import socket
+import time
+
+REQUEST = "GET /uptime HTTP/1.1\r\nHost: {host}\r\n{extra}\r\n"
+
+
+def read_response(sock, buf):
+    """Read one response with a Content-Length or chunked body, return leftover data."""
+    while b"\r\n\r\n" not in buf:
+        data = sock.recv(4096)
+        if not data:
+            raise ConnectionError("connection closed")
+        buf += data
+
+    head, buf = buf.split(b"\r\n\r\n", 1)
+    headers = {}
+    for line in head.split(b"\r\n")[1:]:
+        name, _, value = line.partition(b":")
+        headers[name.strip().lower()] = value.strip().lower()
+
+    if b"content-length" in headers:
+        length = int(headers[b"content-length"])
+        while len(buf) < length:
+            buf += sock.recv(4096)
+        return buf[length:], headers
+
+    # Chunked transfer encoding
+    while True:
+        while b"\r\n" not in buf:
+            buf += sock.recv(4096)
+        size_line, buf = buf.split(b"\r\n", 1)
+        size = int(size_line.split(b";")[0], 16)
+        while len(buf) < size + 2:
+            buf += sock.recv(4096)
+        buf = buf[size + 2:]
+        if size == 0:
+            return buf, headers
+
+
+def bench_close(host, port, count):
+    for _ in range(count):
+        with socket.create_connection((host, port), timeout=5) as sock:
+            sock.sendall(REQUEST.format(host=host, extra="Connection: close\r\n").encode())
+            read_response(sock, b"")
+    return count
+
+
+def bench_keepalive(host, port, count, depth):
+    done = 0
+    sock = None
+    buf = b""
+
+    while done < count:
+        if sock is None:
+            sock = socket.create_connection((host, port), timeout=5)
+            buf = b""
+
+        batch = min(depth, count - done)
+        sock.sendall(REQUEST.format(host=host, extra="").encode() * batch)
+        for _ in range(batch):
+            buf, headers = read_response(sock, buf)
+            done += 1
+            if headers.get(b"connection") == b"close":
+                # Server side request limit reached, remaining requests are lost
+                sock.close()
+                sock = None
+                break
+
+    if sock is not None:
+        sock.close()
+
+    return done
+
+
+def run(name, fn):
+    start = time.perf_counter()
+    count = fn()
+    elapsed = time.perf_counter() - start
+    print(f"{name:<10} {count:5d} requests  {count / elapsed:8.1f} req/s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--requests", type=int, default=100)
+    parser.add_argument("--depth", type=int, default=4, help="pipelining depth")
+    args = parser.parse_args()
+
+    run("close", lambda: bench_close(args.host, args.port, args.requests))
+    run("keepalive", lambda: bench_keepalive(args.host, args.port, args.requests, 1))
+    run("pipeline", lambda: bench_keepalive(args.host, args.port, args.requests, args.depth))
+
+    with socket.create_connection((args.host, args.port), timeout=5) as sock:
+        sock.sendall(b"GET /stats/http HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n")
+        data = b""
+        while chunk := sock.recv(4096):
+            data += chunk
+    body = data.split(b"\r\n\r\n", 1)[1]
+    start = body.find(b"{")
+    print("server:", json.loads(body[start:body.rfind(b"}") + 1]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compare dashboard page-load cost over HTTP/1.1 and HTTP/2 (h2c).
+
+Loads the resources fetched by the dashboard ("/", "/main.js" and "/uptime")
+the way a browser without keep-alive does over HTTP/1.1 (one connection per
+resource) and over a single HTTP/2 connection using prior knowledge, and
+reports the number of TCP connections, bytes on the wire and wall time.
+
+Requires the "h2" package (pip install h2).
+
+Example:
+    ./bench_page_load.py 192.0.2.1 --port 80 --runs 20
+"""
+
+import argparse
+import socket
+import statistics
+import time
+
+import h2.config
+import h2.connection
+import h2.events
+
+RESOURCES = ["/", "/main.js", "/uptime"]
+
+
+class CountingSocket:
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port), timeout=5)
+        self.tx = 0
+        self.rx = 0
+
+    def send(self, data):
+        self.sock.sendall(data)
+        self.tx += len(data)
+
+    def recv(self, size=4096):
+        data = self.sock.recv(size)
+        self.rx += len(data)
+        return data
+
+    def close(self):
+        self.sock.close()
+
+
+def load_http1(host, port):
+    tx = rx = 0
+
+    for path in RESOURCES:
+        conn = CountingSocket(host, port)
+        conn.send(
+            f"GET {path} HTTP/1.1\r\nHost: {host}\r\n"
+            "Accept-Encoding: gzip\r\nConnection: close\r\n\r\n".encode()
+        )
+        while conn.recv():
+            pass
+        conn.close()
+        tx += conn.tx
+        rx += conn.rx
+
+    return len(RESOURCES), tx, rx
+
+
+def load_http2(host, port, mode):
+    conn = CountingSocket(host, port)
+    h2conn = h2.connection.H2Connection(
+        config=h2.config.H2Configuration(client_side=True, header_encoding="utf-8")
+    )
+    pending = set()
+    first = RESOURCES
+
+    if mode == "upgrade":
+        # The first resource rides on the HTTP/1.1 Upgrade request as stream 1
+        settings = h2conn.initiate_upgrade_connection()
+        conn.send(
+            f"GET {RESOURCES[0]} HTTP/1.1\r\nHost: {host}\r\n"
+            "Connection: Upgrade, HTTP2-Settings\r\nUpgrade: h2c\r\n"
+            f"HTTP2-Settings: {settings.decode()}\r\n\r\n".encode()
+        )
+        response = b""
+        while b"\r\n\r\n" not in response:
+            response += conn.recv()
+        if b" 101 " not in response.split(b"\r\n", 1)[0]:
+            raise RuntimeError("server refused h2c upgrade")
+        h2conn.receive_data(response.split(b"\r\n\r\n", 1)[1])
+        pending.add(1)
+        first = RESOURCES[1:]
+    else:
+        h2conn.initiate_connection()
+
+    for path in first:
+        stream_id = h2conn.get_next_available_stream_id()
+        h2conn.send_headers(
+            stream_id,
+            [
+                (":method", "GET"),
+                (":scheme", "http"),
+                (":authority", host),
+                (":path", path),
+                ("accept-encoding", "gzip"),
+            ],
+            end_stream=True,
+        )
+        pending.add(stream_id)
+    conn.send(h2conn.data_to_send())
+
+    while pending:
+        data = conn.recv()
+        if not data:
+            raise RuntimeError("connection closed with streams pending")
+        for event in h2conn.receive_data(data):
+            if isinstance(event, h2.events.DataReceived):
+                h2conn.acknowledge_received_data(event.flow_controlled_length, event.stream_id)
+            elif isinstance(event, (h2.events.StreamEnded, h2.events.StreamReset)):
+                pending.discard(event.stream_id)
+        out = h2conn.data_to_send()
+        if out:
+            conn.send(out)
+
+    h2conn.close_connection()
+    conn.send(h2conn.data_to_send())
+    conn.close()
+
+    return 1, conn.tx, conn.rx
+
+
+def run(name, fn, runs):
+    times = []
+
+    for _ in range(runs):
+        start = time.perf_counter()
+        conns, tx, rx = fn()
+        times.append((time.perf_counter() - start) * 1000)
+
+    print(
+        f"{name:<14} conns={conns:<3} tx={tx:<6} rx={rx:<7} "
+        f"median={statistics.median(times):7.2f} ms  max={max(times):7.2f} ms"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--runs", type=int, default=10)
+    args = parser.parse_args()
+
+    run("http/1.1", lambda: load_http1(args.host, args.port), args.runs)
+    run("h2c prior", lambda: load_http2(args.host, args.port, "prior"), args.runs)
+    run("h2c upgrade", lambda: load_http2(args.host, args.port, "upgrade"), args.runs)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Build every build profile for native_sim and benchmark it.
+
+For each overlay-<profile>.conf, builds the sample with west, reports the
+static RAM and flash of the image, starts it and measures keep-alive
+request rate and websocket echo throughput against it. Prints one markdown
+table row per profile. With --static-only the images are only built and
+measured, which needs no network setup.
+
+native_sim reaches the host through the zeth tap interface, which Zephyr's
+net-tools net-setup.sh creates. Pass its address with --host and give the
+image the matching CONFIG_NET_CONFIG_MY_IPV4_ADDR through --extra-conf.
+
+Example:
+    ./bench_profiles.py --host 192.0.2.1 --extra-conf native-net.conf
+    ./bench_profiles.py --static-only --board stm32f4_disco
+"""
+
+import argparse
+import os
+import socket
+import subprocess
+import time
+
+from elftools.elf.constants import SH_FLAGS
+from elftools.elf.elffile import ELFFile
+
+from bench_keepalive import bench_keepalive
+from bench_ws_echo import bench as bench_echo
+
+PROFILES = ["low-mem", "balanced", "max-throughput"]
+APP_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def build(profile, board, extra_conf):
+    build_dir = os.path.join(APP_DIR, "build", f"profile-{profile}")
+    confs = [os.path.join(APP_DIR, f"overlay-{profile}.conf")] + extra_conf
+    subprocess.run(["west", "build", "-p", "auto", "-b", board, "-d", build_dir, APP_DIR,
+                    "--", f"-DOVERLAY_CONFIG={';'.join(confs)}"],
+                   check=True, stdout=subprocess.DEVNULL)
+    return os.path.join(build_dir, "zephyr")
+
+
+def footprint(elf_path):
+    """Bytes of writable sections, initialised or not, and of loaded read-only ones"""
+    ram = rom = 0
+    with open(elf_path, "rb") as f:
+        elf = ELFFile(f)
+        for section in elf.iter_sections():
+            flags = section["sh_flags"]
+            if not flags & SH_FLAGS.SHF_ALLOC:
+                continue
+            if flags & SH_FLAGS.SHF_WRITE:
+                ram += section["sh_size"]
+            else:
+                rom += section["sh_size"]
+    return ram, rom
+
+
+def wait_up(host, port, timeout=30):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            socket.create_connection((host, port), timeout=1).close()
+            return
+        except OSError:
+            time.sleep(0.5)
+    raise TimeoutError(f"{host}:{port} did not come up")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="192.0.2.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--board", default="native_sim")
+    parser.add_argument("--extra-conf", action="append", default=[],
+                        help="additional overlay config, may be repeated")
+    parser.add_argument("--requests", type=int, default=500)
+    parser.add_argument("--count", type=int, default=50, help="echo messages per size")
+    parser.add_argument("--profile", action="append", choices=PROFILES,
+                        help="only these profiles, may be repeated")
+    parser.add_argument("--static-only", action="store_true",
+                        help="only build and report the footprint")
+    args = parser.parse_args()
+
+    if args.static_only:
+        print("| profile | static RAM (B) | flash (B) |")
+        print("|---|---:|---:|")
+    else:
+        print("| profile | static RAM (B) | flash (B) | req/s | echo 1 KiB (KiB/s) "
+              "| echo 16 KiB (KiB/s) |")
+        print("|---|---:|---:|---:|---:|---:|")
+
+    for profile in args.profile or PROFILES:
+        zephyr_dir = build(profile, args.board, [os.path.abspath(c) for c in args.extra_conf])
+        ram, rom = footprint(os.path.join(zephyr_dir, "zephyr.elf"))
+
+        if args.static_only:
+            print(f"| {profile} | {ram} | {rom} |")
+            continue
+
+        proc = subprocess.Popen([os.path.join(zephyr_dir, "zephyr.exe")],
+                                stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            wait_up(args.host, args.port)
+
+            start = time.perf_counter()
+            done = bench_keepalive(args.host, args.port, args.requests, 4)
+            rate = done / (time.perf_counter() - start)
+
+            echo_1k = bench_echo(args.host, args.port, "/ws_echo_msg", 1024, args.count, 0, True)
+            echo_16k = bench_echo(args.host, args.port, "/ws_echo_msg", 16384, args.count, 0,
+                                  True)
+        finally:
+            proc.terminate()
+            proc.wait()
+
+        print(f"| {profile} | {ram} | {rom} | {rate:.0f} | {echo_1k:.0f} | {echo_16k:.0f} |")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure the round trip throughput of the serial bridge.
+
+Sends blocks of data to "/ws_serial" and reads them back, which needs the
+bridge UART looped back (the UART emulator on native_sim, or TX wired to RX
+on the board). Prints the echoed rate next to the device side counters from
+/stats/serial.
+
+Example:
+    ./bench_serial_bridge.py 192.0.2.1 --seconds 10 --block 64
+"""
+
+import argparse
+import os
+import time
+
+from bench_ws_deflate import http_get_json
+from ws_client import WebSocket
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--block", type=int, default=64)
+    args = parser.parse_args()
+
+    ws = WebSocket(args.host, args.port, "/ws_serial")
+    sent = 0
+    echoed = 0
+    messages = 0
+    start = time.perf_counter()
+
+    while time.perf_counter() - start < args.seconds:
+        block = os.urandom(args.block)
+        ws.send_message(block)
+        sent += len(block)
+
+        # Idle line flushes may split or merge blocks, so read until the
+        # echo catches up rather than expecting one message per block
+        while echoed < sent:
+            _, payload = ws.recv_message()
+            echoed += len(payload)
+            messages += 1
+
+    elapsed = time.perf_counter() - start
+    ws.close()
+
+    stats = http_get_json(args.host, args.port, "/stats/serial")
+    print(f"client: {echoed / elapsed / 1024:.1f} KiB/s echoed in {messages} messages,"
+          f" {echoed / max(messages, 1):.0f} bytes per message")
+    print(f"device: {stats['baud']} baud, {stats['rx_bytes']} rx, {stats['tx_bytes']} tx,"
+          f" {stats['rx_overruns']}/{stats['tx_overruns']}/{stats['uart_overruns']}"
+          f" rx/tx/uart overruns, {stats['errors']} errors")
+
+
+if __name__ == "__main__":
+    main()
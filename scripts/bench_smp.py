@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure how echo throughput scales with the CPUs of an SMP build.
+
+Runs one to --clients websocket echo clients in parallel against
+"/ws_echo_msg" and reports, for each client count, the aggregate
+throughput and the load of every CPU taken from /stats/cpu. Repeat against
+builds with CONFIG_MP_MAX_NUM_CPUS=1 to 4 to compare, see overlay-smp.conf.
+
+Example:
+    ./bench_smp.py 192.0.2.1 --clients 4 --seconds 10
+"""
+
+import argparse
+import os
+import threading
+import time
+
+from bench_ws_deflate import http_get_json
+from ws_client import WebSocket
+
+
+def echo_client(host, port, size, deadline, totals, index):
+    ws = WebSocket(host, port, "/ws_echo_msg")
+    payload = os.urandom(size)
+    echoed = 0
+
+    while time.perf_counter() < deadline:
+        ws.send_message(payload)
+        _, reply = ws.recv_message()
+        if reply != payload:
+            raise AssertionError(f"client {index} got a corrupted echo")
+        echoed += len(reply)
+
+    ws.close()
+    totals[index] = echoed
+
+
+def cpu_load(before, after):
+    loads = []
+    for b, a in zip(before["cpus"], after["cpus"]):
+        total = a["total"] - b["total"]
+        loads.append(100 * (a["busy"] - b["busy"]) / total if total else 0)
+    return loads
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--size", type=int, default=1024)
+    parser.add_argument("--seconds", type=float, default=10)
+    args = parser.parse_args()
+
+    print(f"{'clients':>7}  {'KiB/s':>8}  cpu load %")
+    for clients in range(1, args.clients + 1):
+        totals = [0] * clients
+        before = http_get_json(args.host, args.port, "/stats/cpu")
+        start = time.perf_counter()
+        deadline = start + args.seconds
+
+        threads = [threading.Thread(target=echo_client,
+                                    args=(args.host, args.port, args.size, deadline, totals, i))
+                   for i in range(clients)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        elapsed = time.perf_counter() - start
+        after = http_get_json(args.host, args.port, "/stats/cpu")
+        loads = " ".join(f"{load:5.1f}" for load in cpu_load(before, after))
+        print(f"{clients:7d}  {2 * sum(totals) / elapsed / 1024:8.1f}  {loads}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Print the startup timeline of the last boot from /stats/startup.
+
+Each task is shown with its wait in the queue and its run time, drawn on a
+common time axis so that overlapping tasks are visible. "ready" is when
+the HTTP server was started, the boot to ready metric to track.
+
+Example:
+    ./bench_startup.py 192.0.2.1
+"""
+
+import argparse
+
+from bench_ws_deflate import http_get_json
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--width", type=int, default=60)
+    args = parser.parse_args()
+
+    stats = http_get_json(args.host, args.port, "/stats/startup")
+    end = max(stats["done_us"], 1)
+    scale = args.width / end
+
+    print(f"main {stats['main_us'] / 1000:.1f} ms, ready {stats['ready_us'] / 1000:.1f} ms,"
+          f" done {stats['done_us'] / 1000:.1f} ms")
+
+    for task in sorted(stats["tasks"], key=lambda t: t["start_us"]):
+        queued = int(task["queued_us"] * scale)
+        start = int(task["start_us"] * scale)
+        stop = max(int(task["end_us"] * scale), start + 1)
+        bar = " " * queued + "." * (start - queued) + "#" * (stop - start)
+        run_ms = (task["end_us"] - task["start_us"]) / 1000
+        err = f"  err {task['err']}" if task["err"] else ""
+        print(f"{task['name']:<18} {bar:<{args.width}} {run_ms:8.1f} ms{err}")
+
+
+if __name__ == "__main__":
+    main()
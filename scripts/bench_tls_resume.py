@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure full and resumed TLS handshake times against the HTTPS service.
+
+Opens a first connection with a full handshake, then reconnects repeatedly
+offering the cached session, and reports handshake time for both cases as
+well as how many reconnects were actually resumed by the server.
+
+Example, with the app running on native_sim behind the zeth TAP interface:
+    ./bench_tls_resume.py 192.0.2.1 --port 443 --runs 20
+"""
+
+import argparse
+import socket
+import ssl
+import statistics
+import time
+
+
+def handshake(ctx, host, port, session=None):
+    raw = socket.create_connection((host, port), timeout=10)
+    start = time.perf_counter()
+    tls = ctx.wrap_socket(raw, server_hostname=host, session=session)
+    elapsed = (time.perf_counter() - start) * 1000
+
+    tls.sendall(f"GET /uptime HTTP/1.1\r\nHost: {host}\r\n\r\n".encode())
+    tls.recv(1024)
+    session, reused = tls.session, tls.session_reused
+    tls.close()
+
+    return elapsed, session, reused
+
+
+def report(name, times):
+    if not times:
+        print(f"{name:<8} n=0")
+        return
+
+    print(
+        f"{name:<8} n={len(times):<3} median={statistics.median(times):8.2f} ms "
+        f"min={min(times):8.2f} ms  max={max(times):8.2f} ms"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=443)
+    parser.add_argument("--runs", type=int, default=10)
+    args = parser.parse_args()
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+    # Session IDs are only resumable with TLS 1.2 on the server side
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+
+    full, resumed = [], []
+
+    for _ in range(args.runs):
+        elapsed, session, _ = handshake(ctx, args.host, args.port)
+        full.append(elapsed)
+
+        elapsed, _, reused = handshake(ctx, args.host, args.port, session)
+        (resumed if reused else full).append(elapsed)
+
+    report("full", full)
+    report("resumed", resumed)
+    print(f"resumption ratio {len(resumed)}/{args.runs}")
+
+
+if __name__ == "__main__":
+    main()
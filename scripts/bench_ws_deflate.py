@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compare plain and compressed net stats websocket bandwidth.
+
+Subscribes to the plain ("/") and compressed ("/netstats.deflate") net stats
+streams in turn, measuring received bytes on the wire per second, and reads
+the compressor counters from /stats/ws to report the CPU cost.
+
+The send interval is a build option, so run once per build, e.g. with
+CONFIG_NET_SAMPLE_WEBSOCKET_STATS_INTERVAL=200 and =20:
+    ./bench_ws_deflate.py 192.0.2.1 --seconds 10 --label 200ms
+"""
+
+import argparse
+import json
+import socket
+import time
+import zlib
+
+from ws_client import WebSocket
+
+
+def http_get_json(host, port, path):
+    with socket.create_connection((host, port), timeout=5) as sock:
+        sock.sendall(f"GET {path} HTTP/1.1\r\nHost: {host}\r\nConnection: close\r\n\r\n".encode())
+        data = b""
+        while chunk := sock.recv(4096):
+            data += chunk
+    body = data.split(b"\r\n\r\n", 1)[1]
+    return json.loads(body[body.find(b"{"):body.rfind(b"}") + 1])
+
+
+def subscribe(host, port, path, seconds, compressed):
+    ws = WebSocket(host, port, path)
+    inflate = zlib.decompressobj(-15)
+    messages = 0
+    start = time.perf_counter()
+    rx_start = ws.rx
+
+    while time.perf_counter() - start < seconds:
+        _, payload = ws.recv_message()
+        if compressed:
+            for line in inflate.decompress(payload).splitlines():
+                json.loads(line)
+                messages += 1
+        else:
+            json.loads(payload)
+            messages += 1
+
+    elapsed = time.perf_counter() - start
+    ws.close()
+
+    return messages, (ws.rx - rx_start) / elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--label", default="")
+    parser.add_argument("--cpu-hz", type=float, default=168e6, help="cycle counter frequency")
+    args = parser.parse_args()
+
+    plain_msgs, plain_bps = subscribe(args.host, args.port, "/", args.seconds, False)
+    before = http_get_json(args.host, args.port, "/stats/ws")
+    z_msgs, z_bps = subscribe(args.host, args.port, "/netstats.deflate", args.seconds, True)
+    after = http_get_json(args.host, args.port, "/stats/ws")
+
+    d_in = after["deflate_in"] - before["deflate_in"]
+    d_out = after["deflate_out"] - before["deflate_out"]
+    cycles = after["deflate_cycles"] - before["deflate_cycles"]
+    per_msg = cycles / z_msgs if z_msgs else 0
+
+    print(f"[{args.label}] plain   {plain_msgs:5d} msgs  {plain_bps:8.0f} B/s on the wire")
+    print(f"[{args.label}] deflate {z_msgs:5d} msgs  {z_bps:8.0f} B/s on the wire "
+          f"({100 * (1 - z_bps / plain_bps):.1f}% saved)")
+    print(f"[{args.label}] payload {d_in} -> {d_out} bytes, "
+          f"{per_msg:.0f} cycles/msg ({1e6 * per_msg / args.cpu_hz:.1f} us/msg), "
+          f"{100 * cycles / args.cpu_hz / args.seconds:.2f}% CPU")
+
+
+if __name__ == "__main__":
+    main()
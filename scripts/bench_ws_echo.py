@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Measure websocket echo throughput for 1 KB to 64 KB messages.
+
+Sends messages of each size to the message preserving echo ("/ws_echo_msg"),
+optionally fragmented, checks that every reply comes back as one message
+with the same opcode and payload, and reports the throughput. The byte
+stream echo ("/ws_echo") is measured for comparison; it only guarantees the
+payload bytes, not the message boundaries.
+
+Example:
+    ./bench_ws_echo.py 192.0.2.1 --count 20 --fragment 4096
+"""
+
+import argparse
+import os
+import time
+
+import ws_client
+from ws_client import WebSocket
+
+SIZES = [1024, 4096, 16384, 65536]
+
+
+def bench(host, port, path, size, count, fragment, strict):
+    ws = WebSocket(host, port, path)
+    payload = os.urandom(size)
+    start = time.perf_counter()
+
+    for i in range(count):
+        opcode = ws_client.OP_TEXT if i % 2 else ws_client.OP_BINARY
+        data = payload.hex()[:size].encode() if opcode == ws_client.OP_TEXT else payload
+        ws.send_message(data, opcode, fragment)
+
+        if strict:
+            reply_op, reply = ws.recv_message()
+            if reply_op != opcode or reply != data:
+                raise AssertionError(f"message {i} of {size} bytes not echoed intact")
+        else:
+            received = 0
+            while received < len(data):
+                _, _, chunk = ws.recv_frame()
+                received += len(chunk)
+
+    elapsed = time.perf_counter() - start
+    ws.close()
+
+    return 2 * size * count / elapsed / 1024
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--count", type=int, default=10)
+    parser.add_argument("--fragment", type=int, default=0, help="client fragment size")
+    args = parser.parse_args()
+
+    print(f"{'size':>6}  {'message KiB/s':>14}  {'stream KiB/s':>13}")
+    for size in SIZES:
+        msg = bench(args.host, args.port, "/ws_echo_msg", size, args.count, args.fragment, True)
+        stream = bench(args.host, args.port, "/ws_echo", size, args.count, args.fragment, False)
+        print(f"{size:6d}  {msg:14.1f}  {stream:13.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Report what the build placed in core coupled memory and RAM code.
+
+Lists the symbols of the CCM output sections and of the ramfunc section of
+the zephyr ELF, largest first, with the space left in CCM. Run by the build
+when NET_SAMPLE_CCM_PLACEMENT or NET_SAMPLE_HOT_CODE_IN_RAM is enabled.
+
+Example:
+    ./ccm_report.py build/zephyr/zephyr.elf
+"""
+
+import argparse
+import sys
+
+from elftools.elf.elffile import ELFFile
+from elftools.elf.sections import SymbolTableSection
+
+CCM_SECTIONS = ("ccm_bss", "ccm_noinit", "ccm_data")
+CODE_SECTIONS = (".ramfunc",)
+
+
+def section_symbols(elf, section):
+    start = section["sh_addr"]
+    end = start + section["sh_size"]
+    symbols = {}
+
+    for symtab in elf.iter_sections():
+        if not isinstance(symtab, SymbolTableSection):
+            continue
+
+        for sym in symtab.iter_symbols():
+            if sym["st_info"]["type"] not in ("STT_OBJECT", "STT_FUNC"):
+                continue
+            if start <= sym["st_value"] < end and sym["st_size"] > 0:
+                symbols[sym.name] = (sym["st_value"], sym["st_size"])
+
+    return sorted(symbols.items(), key=lambda item: -item[1][1])
+
+
+def report(elf, names, out):
+    total = 0
+
+    for section in elf.iter_sections():
+        if section.name not in names or section["sh_size"] == 0:
+            continue
+
+        out.write(f"{section.name}: {section['sh_size']} bytes at 0x{section['sh_addr']:08x}\n")
+        for name, (addr, size) in section_symbols(elf, section):
+            out.write(f"  0x{addr:08x} {size:8} {name}\n")
+        total += section["sh_size"]
+
+    return total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("elf")
+    parser.add_argument("-o", "--output", help="write the report here instead of stdout")
+    parser.add_argument("--ccm-size", type=int, default=64 * 1024)
+    args = parser.parse_args()
+
+    out = open(args.output, "w") if args.output else sys.stdout
+
+    with open(args.elf, "rb") as f:
+        elf = ELFFile(f)
+
+        ccm = report(elf, CCM_SECTIONS, out)
+        out.write(f"CCM: {ccm} of {args.ccm_size} bytes used, "
+                  f"{args.ccm_size - ccm} left\n\n")
+
+        code = report(elf, CODE_SECTIONS, out)
+        out.write(f"RAM code: {code} bytes\n")
+
+    if args.output:
+        out.close()
+        print(f"CCM: {ccm} of {args.ccm_size} bytes used, RAM code: {code} bytes,"
+              f" see {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,116 @@
+#
+# Copyright (c) 2024, Witekio
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Minimal blocking WebSocket client used by the benchmark scripts.
+
+Only what the benchmarks need: the HTTP/1.1 upgrade, masked client frames,
+and frame level receive that exposes opcodes and the FIN bit. Bytes on the
+wire are counted in both directions.
+"""
+
+import base64
+import os
+import socket
+import struct
+
+OP_CONT = 0x0
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xA
+
+
+class WebSocket:
+    def __init__(self, host, port, path, timeout=10, token=None):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.tx = 0
+        self.rx = 0
+        self._buf = b""
+
+        key = base64.b64encode(os.urandom(16)).decode()
+        auth = f"Authorization: Bearer {token}\r\n" if token else ""
+        self._send_raw(
+            f"GET {path} HTTP/1.1\r\nHost: {host}\r\nUpgrade: websocket\r\n"
+            f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n{auth}"
+            "Sec-WebSocket-Version: 13\r\n\r\n".encode()
+        )
+        while b"\r\n\r\n" not in self._buf:
+            self._fill()
+        head, self._buf = self._buf.split(b"\r\n\r\n", 1)
+        if b" 101 " not in head.split(b"\r\n", 1)[0]:
+            raise ConnectionError(f"upgrade of {path} refused: {head[:64]!r}")
+
+    def _send_raw(self, data):
+        self.sock.sendall(data)
+        self.tx += len(data)
+
+    def _fill(self):
+        data = self.sock.recv(65536)
+        if not data:
+            raise ConnectionError("connection closed")
+        self.rx += len(data)
+        self._buf += data
+
+    def _take(self, size):
+        while len(self._buf) < size:
+            self._fill()
+        data, self._buf = self._buf[:size], self._buf[size:]
+        return data
+
+    def send_frame(self, opcode, payload, fin=True):
+        header = bytes([(0x80 if fin else 0) | opcode])
+        length = len(payload)
+        if length < 126:
+            header += bytes([0x80 | length])
+        elif length < 65536:
+            header += bytes([0x80 | 126]) + struct.pack("!H", length)
+        else:
+            header += bytes([0x80 | 127]) + struct.pack("!Q", length)
+        mask = os.urandom(4)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self._send_raw(header + mask + masked)
+
+    def send_message(self, payload, opcode=OP_BINARY, fragment=0):
+        """Send a message, split into frames of at most fragment bytes if non zero."""
+        if not fragment or len(payload) <= fragment:
+            self.send_frame(opcode, payload)
+            return
+
+        for offset in range(0, len(payload), fragment):
+            chunk = payload[offset:offset + fragment]
+            last = offset + fragment >= len(payload)
+            self.send_frame(opcode if offset == 0 else OP_CONT, chunk, fin=last)
+
+    def recv_frame(self):
+        """Return (opcode, fin, payload) of the next frame, answering pings."""
+        while True:
+            b0, b1 = self._take(2)
+            length = b1 & 0x7F
+            if length == 126:
+                length = struct.unpack("!H", self._take(2))[0]
+            elif length == 127:
+                length = struct.unpack("!Q", self._take(8))[0]
+            payload = self._take(length)
+            opcode = b0 & 0x0F
+            if opcode == OP_PING:
+                self.send_frame(OP_PONG, payload)
+                continue
+            return opcode, bool(b0 & 0x80), payload
+
+    def recv_message(self):
+        """Return (opcode, payload) of the next complete message."""
+        opcode, fin, payload = self.recv_frame()
+        while not fin:
+            _, fin, more = self.recv_frame()
+            payload += more
+        return opcode, payload
+
+    def close(self):
+        try:
+            self.send_frame(OP_CLOSE, struct.pack("!H", 1000))
+        except OSError:
+            pass
+        self.sock.close()
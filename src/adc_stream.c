@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "adc_stream.h"
+#include "route.h"
+#include "ws.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define ADC_STREAM_STACK_SIZE 1024
+#define ADC_STREAM_PRIORITY K_PRIO_PREEMPT(6)
+
+#define ADC_CHANNELS DT_PROP_LEN(DT_PATH(zephyr_user), io_channels)
+#define ADC_FRAMES CONFIG_NET_SAMPLE_ADC_STREAM_FRAMES
+#define ADC_DECIMATION CONFIG_NET_SAMPLE_ADC_STREAM_DECIMATION
+
+BUILD_ASSERT(ADC_FRAMES % ADC_DECIMATION == 0,
+	     "ADC block frames must be a multiple of the decimation");
+
+#define ADC_DT_SPEC_AND_COMMA(node_id, prop, idx) ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
+
+static const struct adc_dt_spec adc_channels[] = {
+	DT_FOREACH_PROP_ELEM(DT_PATH(zephyr_user), io_channels, ADC_DT_SPEC_AND_COMMA)
+};
+
+enum adc_block_state {
+	ADC_BLOCK_FREE,
+	ADC_BLOCK_FILLING,
+	ADC_BLOCK_READY,
+	ADC_BLOCK_LENT,
+};
+
+/* Samples are converted straight behind the header, so a completed block
+ * is sent as is.
+ */
+struct adc_block {
+	atomic_t state;
+	size_t len;
+	uint8_t buf[ADC_STREAM_HDR_LEN + ADC_FRAMES * ADC_CHANNELS * sizeof(int16_t)] __aligned(4);
+};
+
+/* One block is filled while the other one is being sent */
+static struct adc_block adc_blocks[2];
+
+static struct k_poll_signal adc_done_signal = K_POLL_SIGNAL_INITIALIZER(adc_done_signal);
+
+static struct adc_sequence_options adc_options = {
+	.interval_us = USEC_PER_SEC / CONFIG_NET_SAMPLE_ADC_STREAM_RATE,
+	.extra_samplings = ADC_FRAMES - 1,
+};
+
+static struct adc_sequence adc_seq;
+
+static int64_t adc_start_time;
+static atomic_t stat_blocks;
+static atomic_t stat_overruns;
+static atomic_t stat_errors;
+
+static int adc_block_start(struct adc_block *block)
+{
+	atomic_set(&block->state, ADC_BLOCK_FILLING);
+
+	sys_put_le32((uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()), &block->buf[4]);
+
+	adc_seq.buffer = &block->buf[ADC_STREAM_HDR_LEN];
+	adc_seq.buffer_size = sizeof(block->buf) - ADC_STREAM_HDR_LEN;
+
+	return adc_read_async(adc_channels[0].dev, &adc_seq, &adc_done_signal);
+}
+
+/* Decimate in place by averaging, then fill in the rest of the header */
+static void adc_block_finish(struct adc_block *block, uint32_t seq)
+{
+	int16_t *samples = (int16_t *)&block->buf[ADC_STREAM_HDR_LEN];
+	size_t frames = ADC_FRAMES / ADC_DECIMATION;
+	int32_t sum;
+
+	if (ADC_DECIMATION > 1) {
+		for (size_t f = 0; f < frames; f++) {
+			for (size_t c = 0; c < ADC_CHANNELS; c++) {
+				sum = 0;
+				for (size_t d = 0; d < ADC_DECIMATION; d++) {
+					sum += samples[(f * ADC_DECIMATION + d) * ADC_CHANNELS + c];
+				}
+
+				samples[f * ADC_CHANNELS + c] = sum / ADC_DECIMATION;
+			}
+		}
+	}
+
+	sys_put_le32(seq, &block->buf[0]);
+	sys_put_le32(CONFIG_NET_SAMPLE_ADC_STREAM_RATE / ADC_DECIMATION, &block->buf[8]);
+	sys_put_le16(ADC_CHANNELS, &block->buf[12]);
+	sys_put_le16(frames, &block->buf[14]);
+
+	block->len = ADC_STREAM_HDR_LEN + frames * ADC_CHANNELS * sizeof(int16_t);
+}
+
+#if defined(CONFIG_ADC_EMUL)
+#include <zephyr/drivers/adc/adc_emul.h>
+
+/* Triangle wave of one second period, shifted by a quarter per channel */
+static int adc_emul_wave(const struct device *dev, unsigned int chan, void *data,
+			 uint32_t *result)
+{
+	uint32_t t = (k_uptime_get_32() + chan * 250) % 1000;
+
+	*result = (t < 500 ? t : 1000 - t) * 6;
+
+	return 0;
+}
+#endif
+
+static int adc_stream_setup(void)
+{
+	int ret;
+
+	for (size_t i = 0; i < ARRAY_SIZE(adc_channels); i++) {
+		if (!adc_is_ready_dt(&adc_channels[i])) {
+			LOG_ERR("ADC %s is not ready", adc_channels[i].dev->name);
+			return -ENODEV;
+		}
+
+		/* A sequence converts channels of a single ADC */
+		if (adc_channels[i].dev != adc_channels[0].dev) {
+			LOG_ERR("ADC stream channels must all be on %s",
+				adc_channels[0].dev->name);
+			return -EINVAL;
+		}
+
+		ret = adc_channel_setup_dt(&adc_channels[i]);
+		if (ret < 0) {
+			LOG_ERR("Failed to set up ADC channel %d, err %d",
+				adc_channels[i].channel_id, ret);
+			return ret;
+		}
+
+#if defined(CONFIG_ADC_EMUL)
+		(void)adc_emul_value_func_set(adc_channels[i].dev, adc_channels[i].channel_id,
+					      adc_emul_wave, NULL);
+#endif
+	}
+
+	ret = adc_sequence_init_dt(&adc_channels[0], &adc_seq);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (size_t i = 1; i < ARRAY_SIZE(adc_channels); i++) {
+		adc_seq.channels |= BIT(adc_channels[i].channel_id);
+	}
+
+	adc_seq.options = &adc_options;
+
+	return 0;
+}
+
+static void adc_stream_thread(void *p1, void *p2, void *p3)
+{
+	struct k_poll_event event = K_POLL_EVENT_INITIALIZER(
+		K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &adc_done_signal);
+	struct adc_block *cur = &adc_blocks[0];
+	struct adc_block *done;
+	struct adc_block *next;
+	unsigned int signaled;
+	uint32_t seq = 0;
+	int result;
+	int ret;
+
+	if (adc_stream_setup() < 0) {
+		return;
+	}
+
+	adc_start_time = k_uptime_get();
+
+	ret = adc_block_start(cur);
+	if (ret < 0) {
+		LOG_ERR("Failed to start ADC sampling, err %d", ret);
+		return;
+	}
+
+	while (true) {
+		(void)k_poll(&event, 1, K_FOREVER);
+		k_poll_signal_check(&adc_done_signal, &signaled, &result);
+		k_poll_signal_reset(&adc_done_signal);
+		event.state = K_POLL_STATE_NOT_READY;
+
+		/* Restart on the other block first, so that the gap between
+		 * two blocks is as short as possible. If that block is still
+		 * being sent, the one just completed is sacrificed instead.
+		 */
+		done = cur;
+		next = &adc_blocks[done == &adc_blocks[0] ? 1 : 0];
+		if (atomic_cas(&next->state, ADC_BLOCK_FREE, ADC_BLOCK_FILLING)) {
+			cur = next;
+		} else {
+			atomic_inc(&stat_overruns);
+		}
+
+		ret = adc_block_start(cur);
+		if (ret < 0) {
+			LOG_ERR("Failed to restart ADC sampling, err %d", ret);
+			atomic_set(&cur->state, ADC_BLOCK_FREE);
+			return;
+		}
+
+		seq++;
+
+		if (cur == done) {
+			continue;
+		}
+
+		if (result < 0) {
+			atomic_inc(&stat_errors);
+			atomic_set(&done->state, ADC_BLOCK_FREE);
+			continue;
+		}
+
+		adc_block_finish(done, seq - 1);
+		atomic_set(&done->state, ADC_BLOCK_READY);
+		atomic_inc(&stat_blocks);
+
+		ws_notify(WS_TOPIC_ADC);
+	}
+}
+
+K_THREAD_DEFINE(adc_stream_tid, ADC_STREAM_STACK_SIZE, adc_stream_thread, NULL, NULL, NULL,
+		ADC_STREAM_PRIORITY, 0, 0);
+
+const uint8_t *adc_stream_borrow(size_t *len)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(adc_blocks); i++) {
+		if (atomic_cas(&adc_blocks[i].state, ADC_BLOCK_READY, ADC_BLOCK_LENT)) {
+			*len = adc_blocks[i].len;
+			return adc_blocks[i].buf;
+		}
+	}
+
+	return NULL;
+}
+
+void adc_stream_release(const uint8_t *buf)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(adc_blocks); i++) {
+		if (buf == adc_blocks[i].buf) {
+			atomic_set(&adc_blocks[i].state, ADC_BLOCK_FREE);
+		}
+	}
+}
+
+static int adc_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+			     const struct http_request_ctx *request_ctx,
+			     struct http_response_ctx *response_ctx,
+			     const struct route_params *params)
+{
+	static char json_buf[192];
+	int64_t elapsed = k_uptime_get() - adc_start_time;
+	uint32_t blocks = atomic_get(&stat_blocks);
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	/* Sustained rate counts only the frames that made it into a block */
+	ret = snprintf(json_buf, sizeof(json_buf),
+		       "{"
+		       "\"rate\":%u,"
+		       "\"decimation\":%u,"
+		       "\"channels\":%u,"
+		       "\"frames\":%u,"
+		       "\"blocks\":%u,"
+		       "\"sustained\":%u,"
+		       "\"overruns\":%u,"
+		       "\"errors\":%u"
+		       "}",
+		       CONFIG_NET_SAMPLE_ADC_STREAM_RATE, ADC_DECIMATION, ADC_CHANNELS, ADC_FRAMES,
+		       blocks,
+		       (uint32_t)(elapsed > 0 ? (int64_t)blocks * ADC_FRAMES * 1000 / elapsed : 0),
+		       (uint32_t)atomic_get(&stat_overruns), (uint32_t)atomic_get(&stat_errors));
+	if (ret >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(adc_stats_route, "/stats/adc", BIT(HTTP_GET), adc_stats_handler);
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_ADC_STREAM_H_
+#define APP_ADC_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ADC blocks are binary websocket messages of little endian fields:
+ *
+ *  u32 seq                       block number, gaps mean lost blocks
+ *  u32 timestamp                 microseconds of uptime of the first frame
+ *  u32 rate                      frames per second after decimation
+ *  u16 channels
+ *  u16 frames
+ *  i16 sample[frames][channels]  raw conversion results
+ */
+#define ADC_STREAM_HDR_LEN 16
+
+/**
+ * @brief Lend the oldest completed block to the websocket push thread
+ *
+ * @param len Set to the length of the block, header included
+ *
+ * @return The block, or NULL if none is ready
+ */
+const uint8_t *adc_stream_borrow(size_t *len);
+
+/**
+ * @brief Give a block back for sampling
+ *
+ * @param buf Block returned by adc_stream_borrow()
+ */
+void adc_stream_release(const uint8_t *buf);
+
+#endif /* APP_ADC_STREAM_H_ */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/input/input.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/spsc_lockfree.h>
+
+#include "button_push.h"
+#include "route.h"
+#include "ws.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define BUTTON_RING_SIZE 16
+
+/* Bucket n > 0 counts latencies from 2^(n-1) up to 2^n microseconds, the
+ * last one everything above.
+ */
+#define BUTTON_HIST_BUCKETS 16
+
+/* Longest JSON text of one event */
+#define BUTTON_EVENT_JSON_MAX 64
+
+struct button_event {
+	uint32_t stamp;
+	uint32_t uptime;
+	uint16_t code;
+	int32_t value;
+};
+
+/* Input callbacks run one after the other on the input thread, which makes
+ * it the single producer.
+ */
+SPSC_DEFINE(button_ring, struct button_event, BUTTON_RING_SIZE);
+
+static atomic_t stat_events;
+static atomic_t stat_dropped;
+static atomic_t stat_sent;
+static atomic_t stat_max_us;
+static atomic_t button_hist[BUTTON_HIST_BUCKETS];
+
+static void button_input_cb(struct input_event *evt, void *user_data)
+{
+	uint32_t stamp = k_cycle_get_32();
+	struct button_event *event;
+
+	if (evt->type != INPUT_EV_KEY) {
+		return;
+	}
+
+	event = spsc_acquire(&button_ring);
+	if (event == NULL) {
+		atomic_inc(&stat_dropped);
+		return;
+	}
+
+	/* 0 means no capture time to the push thread */
+	event->stamp = stamp != 0 ? stamp : 1;
+	event->uptime = k_uptime_get_32();
+	event->code = evt->code;
+	event->value = evt->value;
+	spsc_produce(&button_ring);
+
+	atomic_inc(&stat_events);
+	ws_notify(WS_TOPIC_BUTTON);
+}
+
+INPUT_CALLBACK_DEFINE(NULL, button_input_cb, NULL);
+
+int button_push_collect(char *buf, size_t maxlen, uint32_t *stamp)
+{
+	struct button_event *event;
+	int count = 0;
+	int len;
+
+	len = snprintf(buf, maxlen, "{\"events\":[");
+
+	while (len + BUTTON_EVENT_JSON_MAX + sizeof("]}") <= maxlen) {
+		event = spsc_consume(&button_ring);
+		if (event == NULL) {
+			break;
+		}
+
+		if (count == 0) {
+			*stamp = event->stamp;
+		}
+
+		len += snprintf(&buf[len], maxlen - len, "%s{\"code\":%u,\"value\":%d,\"t\":%u}",
+				count > 0 ? "," : "", event->code, event->value, event->uptime);
+		count++;
+
+		spsc_release(&button_ring);
+	}
+
+	if (spsc_consumable(&button_ring) > 0) {
+		ws_notify(WS_TOPIC_BUTTON);
+	}
+
+	if (count == 0) {
+		return -ENODATA;
+	}
+
+	len += snprintf(&buf[len], maxlen - len, "]}");
+
+	return len;
+}
+
+void button_push_sent(uint32_t stamp)
+{
+	uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - stamp);
+	atomic_val_t max;
+
+	atomic_inc(&stat_sent);
+	atomic_inc(&button_hist[MIN(find_msb_set(us), BUTTON_HIST_BUCKETS - 1)]);
+
+	do {
+		max = atomic_get(&stat_max_us);
+	} while (us > max && !atomic_cas(&stat_max_us, max, us));
+}
+
+static int button_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+				const struct http_request_ctx *request_ctx,
+				struct http_response_ctx *response_ctx,
+				const struct route_params *params)
+{
+	static char json_buf[256];
+	int len;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	len = snprintf(json_buf, sizeof(json_buf),
+		       "{\"events\":%u,\"dropped\":%u,\"sent\":%u,\"max_us\":%u,\"hist_us\":[",
+		       (uint32_t)atomic_get(&stat_events), (uint32_t)atomic_get(&stat_dropped),
+		       (uint32_t)atomic_get(&stat_sent), (uint32_t)atomic_get(&stat_max_us));
+
+	for (int i = 0; i < BUTTON_HIST_BUCKETS && len < sizeof(json_buf); i++) {
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len, "%s%u", i > 0 ? "," : "",
+				(uint32_t)atomic_get(&button_hist[i]));
+	}
+
+	if (len < sizeof(json_buf)) {
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len, "]}");
+	}
+
+	if (len >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = len;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(button_stats_route, "/stats/button", BIT(HTTP_GET), button_stats_handler);
+
+#if defined(CONFIG_GPIO_EMUL) && defined(CONFIG_SHELL) && DT_NODE_EXISTS(DT_NODELABEL(button0))
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/shell/shell.h>
+
+static const struct gpio_dt_spec button_gpio = GPIO_DT_SPEC_GET(DT_NODELABEL(button0), gpios);
+
+/* Drive the emulated pin, so the press goes through the gpio-keys
+ * interrupt and debouncing like a real one.
+ */
+static int cmd_button_press(const struct shell *sh, size_t argc, char **argv)
+{
+	int active = (button_gpio.dt_flags & GPIO_ACTIVE_LOW) ? 0 : 1;
+
+	gpio_emul_input_set(button_gpio.port, button_gpio.pin, active);
+	k_msleep(100);
+	gpio_emul_input_set(button_gpio.port, button_gpio.pin, !active);
+
+	shell_print(sh, "button0 pressed and released");
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(button_press, NULL, "Press the emulated button0", cmd_button_press);
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BUTTON_PUSH_H_
+#define APP_BUTTON_PUSH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Format buffered key events as one JSON message
+ *
+ * Called by the websocket push thread for WS_TOPIC_BUTTON.
+ *
+ * @param buf Output buffer
+ * @param maxlen Size of the output buffer
+ * @param stamp Set to the capture time of the oldest event in the message
+ *
+ * @return Length of the message on success, -ENODATA if there was no event
+ */
+int button_push_collect(char *buf, size_t maxlen, uint32_t *stamp);
+
+/**
+ * @brief Account the latency of a message that went out to a subscriber
+ *
+ * @param stamp Capture time set by button_push_collect()
+ */
+void button_push_sent(uint32_t stamp);
+
+#endif /* APP_BUTTON_PUSH_H_ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+
+#include "conn_state.h"
+
+/* One entry per client context of the http and https services, HTTP/2
+ * clients with body chunks of several streams in flight take one per stream
+ */
+#define CONN_STATE_MAX (2 * CONFIG_HTTP_SERVER_MAX_CLIENTS)
+
+static struct conn_state conn_states[CONN_STATE_MAX];
+static struct k_spinlock conn_state_lock;
+
+static inline bool conn_state_is(const struct conn_state *state,
+				 const struct http_client_ctx *client)
+{
+	return state->client == client && state->stream == client->current_stream;
+}
+
+struct conn_state *conn_state_get(const struct http_client_ctx *client)
+{
+	k_spinlock_key_t key = k_spin_lock(&conn_state_lock);
+	struct conn_state *free = NULL;
+	struct conn_state *state = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(conn_states); i++) {
+		if (conn_state_is(&conn_states[i], client)) {
+			state = &conn_states[i];
+			break;
+		}
+
+		if (free == NULL && conn_states[i].client == NULL) {
+			free = &conn_states[i];
+		}
+	}
+
+	if (state == NULL && free != NULL) {
+		memset(free, 0, sizeof(*free));
+		free->client = client;
+		free->stream = client->current_stream;
+		state = free;
+	}
+
+	k_spin_unlock(&conn_state_lock, key);
+
+	return state;
+}
+
+void conn_state_release(const struct http_client_ctx *client)
+{
+	k_spinlock_key_t key = k_spin_lock(&conn_state_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(conn_states); i++) {
+		if (conn_state_is(&conn_states[i], client)) {
+			conn_states[i].client = NULL;
+			break;
+		}
+	}
+
+	k_spin_unlock(&conn_state_lock, key);
+}
+
+int conn_state_append(struct conn_state *state, const uint8_t *data, size_t len)
+{
+	if (state->body_len + len > sizeof(state->body)) {
+		return -ENOMEM;
+	}
+
+	memcpy(&state->body[state->body_len], data, len);
+	state->body_len += len;
+
+	return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CONN_STATE_H_
+#define APP_CONN_STATE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/net/http/server.h>
+
+#include "route.h"
+
+/** Room for a request body gathered over several chunks */
+#define CONN_STATE_BODY_MAX 32
+
+/**
+ * @brief State of the request in progress on one client connection
+ *
+ * A request body may arrive in several chunks with chunks of other clients,
+ * or of other HTTP/2 streams of the same client, in between. Whatever a
+ * callback keeps from one chunk to the next belongs here rather than in
+ * function statics. Each response chunk is sent before the server calls
+ * back again, so its buffer may be shared, but the position in a streamed
+ * response is kept here.
+ */
+struct conn_state {
+	const struct http_client_ctx *client;
+	const void *stream;
+	/* Route matched on the first chunk, see route_dispatch() */
+	const struct app_route *route;
+	struct route_params params;
+	/* Bytes of request body seen so far, kept or not */
+	size_t received;
+	/* Set once the first response chunk is out, by route_dispatch() for
+	 * routes
+	 */
+	bool responding;
+	/* Position and end of a response body streamed over several callbacks */
+	size_t offset;
+	size_t end;
+	/* Request body kept with conn_state_append() */
+	size_t body_len;
+	uint8_t body[CONN_STATE_BODY_MAX];
+};
+
+/**
+ * @brief Get the request state of a client stream, starting it if needed
+ *
+ * A new state is zeroed.
+ *
+ * @param client HTTP client context
+ *
+ * @return Request state, NULL if all are in use
+ */
+struct conn_state *conn_state_get(const struct http_client_ctx *client);
+
+/**
+ * @brief End the request state of a client stream
+ *
+ * Called by the resource callback the server invoked, once the request is
+ * complete or aborted. Does nothing if the client has no state.
+ *
+ * @param client HTTP client context
+ */
+void conn_state_release(const struct http_client_ctx *client);
+
+/**
+ * @brief Append a request body chunk to the state
+ *
+ * @param state Request state
+ * @param data Chunk of the body
+ * @param len Length of the chunk
+ *
+ * @return 0 on success, -ENOMEM if the body exceeds CONN_STATE_BODY_MAX
+ */
+int conn_state_append(struct conn_state *state, const uint8_t *data, size_t len);
+
+#endif /* APP_CONN_STATE_H_ */
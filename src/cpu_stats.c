@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+
+#include "route.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+/* Cycle counters of every CPU since boot, a client samples them twice and
+ * compares to see how the load spreads over the cores.
+ */
+static int cpu_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+			     const struct http_request_ctx *request_ctx,
+			     struct http_response_ctx *response_ctx,
+			     const struct route_params *params)
+{
+	static char json_buf[64 + 64 * CONFIG_MP_MAX_NUM_CPUS];
+	k_thread_runtime_stats_t stats;
+	size_t len;
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	len = snprintf(json_buf, sizeof(json_buf), "{\"hz\":%u,\"cpus\":[",
+		       sys_clock_hw_cycles_per_sec());
+
+	for (unsigned int cpu = 0; cpu < arch_num_cpus(); cpu++) {
+		ret = k_thread_runtime_stats_cpu_get(cpu, &stats);
+		if (ret < 0) {
+			return ret;
+		}
+
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len,
+				"%s{\"busy\":%llu,\"total\":%llu}", cpu > 0 ? "," : "",
+				(unsigned long long)stats.total_cycles,
+				(unsigned long long)stats.execution_cycles);
+		if (len >= sizeof(json_buf)) {
+			return -ENOSPC;
+		}
+	}
+
+	len += snprintf(&json_buf[len], sizeof(json_buf) - len, "]}");
+	if (len >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = len;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(cpu_stats_route, "/stats/cpu", BIT(HTTP_GET), cpu_stats_handler);
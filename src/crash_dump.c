@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/debug/coredump.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+
+#include "conn_state.h"
+#include "crash_dump.h"
+#include "http_auth.h"
+#include "http_stats.h"
+#include "startup.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+static const struct http_header crash_dump_headers[] = {
+	{.name = "Content-Type", .value = "application/octet-stream"},
+	{.name = "Content-Disposition", .value = "attachment; filename=\"coredump.bin\""},
+};
+
+/* Shared by all clients, each chunk is sent before the next callback */
+static uint8_t crash_dump_chunk[CONFIG_NET_SAMPLE_CRASH_DUMP_CHUNK];
+
+static int crash_dump_size(void)
+{
+	int ret;
+
+	ret = coredump_query(COREDUMP_QUERY_HAS_STORED_DUMP, NULL);
+	if (ret <= 0) {
+		return ret < 0 ? ret : -ENOENT;
+	}
+
+	return coredump_query(COREDUMP_QUERY_GET_STORED_DUMP_SIZE, NULL);
+}
+
+static int crash_dump_get(struct http_client_ctx *client, struct conn_state *state,
+			  struct http_response_ctx *response_ctx)
+{
+	struct coredump_cmd_copy_arg copy;
+	int size;
+	int ret;
+
+	/* Headers go out with the first chunk only */
+	if (!state->responding) {
+		size = crash_dump_size();
+		if (size < 0) {
+			response_ctx->status = HTTP_404_NOT_FOUND;
+			response_ctx->final_chunk = true;
+			return http_stats_request_done(client, response_ctx);
+		}
+
+		state->responding = true;
+		state->end = size;
+
+		response_ctx->headers = crash_dump_headers;
+		response_ctx->header_count = ARRAY_SIZE(crash_dump_headers);
+		ret = http_stats_request_done(client, response_ctx);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	copy.offset = state->offset;
+	copy.buffer = crash_dump_chunk;
+	copy.length = MIN(sizeof(crash_dump_chunk), state->end - state->offset);
+
+	ret = coredump_cmd(COREDUMP_CMD_COPY_STORED_DUMP, &copy);
+	if (ret <= 0) {
+		/* Erased while being downloaded, or a flash error */
+		LOG_ERR("Failed to read core dump at %zu, err %d", state->offset, ret);
+		return ret < 0 ? ret : -EIO;
+	}
+
+	state->offset += ret;
+
+	response_ctx->body = crash_dump_chunk;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = state->offset >= state->end;
+
+	return 0;
+}
+
+static int crash_dump_handler(struct http_client_ctx *client, enum http_data_status status,
+			      const struct http_request_ctx *request_ctx,
+			      struct http_response_ctx *response_ctx, void *user_data)
+{
+	struct conn_state *state;
+	int ret;
+
+	state = conn_state_get(client);
+	if (state == NULL) {
+		return -ENOMEM;
+	}
+
+	if (status == HTTP_SERVER_DATA_ABORTED) {
+		conn_state_release(client);
+		return 0;
+	}
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	/* The dump holds every thread stack, keys included */
+	if (!state->responding && !http_auth_bearer_ok(request_ctx)) {
+		response_ctx->status = HTTP_401_UNAUTHORIZED;
+		response_ctx->headers = &http_auth_challenge_header;
+		response_ctx->header_count = 1;
+		response_ctx->final_chunk = true;
+		ret = http_stats_request_done(client, response_ctx);
+	} else if (client->method == HTTP_DELETE) {
+		ret = coredump_cmd(COREDUMP_CMD_ERASE_STORED_DUMP, NULL);
+		response_ctx->status = ret < 0 ? HTTP_500_INTERNAL_SERVER_ERROR : HTTP_200_OK;
+		response_ctx->final_chunk = true;
+		ret = http_stats_request_done(client, response_ctx);
+	} else {
+		ret = crash_dump_get(client, state, response_ctx);
+	}
+
+	if (ret < 0 || response_ctx->final_chunk) {
+		conn_state_release(client);
+	}
+
+	return ret;
+}
+
+struct http_resource_detail_dynamic crash_dump_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_DYNAMIC,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET) | BIT(HTTP_DELETE),
+		},
+	.cb = crash_dump_handler,
+	.user_data = NULL,
+};
+
+/* Point out a dump left by the previous run, the check reads flash */
+static int crash_dump_check(void)
+{
+	int size = crash_dump_size();
+
+	if (size > 0) {
+		LOG_WRN("Core dump of %d bytes stored, download it from /coredump", size);
+	}
+
+	return 0;
+}
+STARTUP_TASK_DEFINE(crash_dump, STARTUP_CRASH_DUMP, 0, crash_dump_check);
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_crash(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(sh, "Raising a fatal error, the core dump follows");
+	k_oops();
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(crash, NULL, "Raise a fatal error to test the core dump", cmd_crash);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CRASH_DUMP_H_
+#define APP_CRASH_DUMP_H_
+
+#include <zephyr/net/http/server.h>
+
+/*
+ * The core dump written to the coredump partition by the last fatal error
+ * is served on GET as application/octet-stream, ready for Zephyr's
+ * scripts/coredump/coredump_gdbserver.py. DELETE erases it.
+ */
+
+/** @brief Dynamic resource detail serving the stored core dump */
+extern struct http_resource_detail_dynamic crash_dump_resource_detail;
+
+#endif /* APP_CRASH_DUMP_H_ */
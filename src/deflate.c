@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <zephyr/sys/util.h>
+
+#include "deflate.h"
+#include "placement.h"
+
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_WINDOW CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE_WINDOW
+
+struct bit_writer {
+	uint8_t *out;
+	size_t len;
+	size_t max;
+	uint32_t bits;
+	unsigned int count;
+	bool overflow;
+};
+
+static const uint16_t length_base[] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+	31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+
+static const uint8_t length_extra[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+	2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+static const uint16_t dist_base[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+	193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+
+static const uint8_t dist_extra[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+	6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+/* __ramfunc functions are never inlined and are reached through a long
+ * call, so the bit writers are forced inline into deflate_compress(),
+ * which alone runs from SRAM.
+ */
+static ALWAYS_INLINE void put_bits(struct bit_writer *bw, uint32_t value, unsigned int count)
+{
+	bw->bits |= value << bw->count;
+	bw->count += count;
+
+	while (bw->count >= 8) {
+		if (bw->len < bw->max) {
+			bw->out[bw->len++] = bw->bits & 0xff;
+		} else {
+			bw->overflow = true;
+		}
+
+		bw->bits >>= 8;
+		bw->count -= 8;
+	}
+}
+
+/* Huffman codes are packed starting from their most significant bit */
+static ALWAYS_INLINE void put_code(struct bit_writer *bw, uint32_t code, unsigned int count)
+{
+	uint32_t reversed = 0;
+
+	for (unsigned int i = 0; i < count; i++) {
+		reversed = (reversed << 1) | ((code >> i) & 1);
+	}
+
+	put_bits(bw, reversed, count);
+}
+
+/* Fixed literal/length code, RFC 1951 section 3.2.6 */
+static ALWAYS_INLINE void put_symbol(struct bit_writer *bw, unsigned int sym)
+{
+	if (sym < 144) {
+		put_code(bw, 0x30 + sym, 8);
+	} else if (sym < 256) {
+		put_code(bw, 0x190 + (sym - 144), 9);
+	} else if (sym < 280) {
+		put_code(bw, sym - 256, 7);
+	} else {
+		put_code(bw, 0xc0 + (sym - 280), 8);
+	}
+}
+
+static ALWAYS_INLINE void put_match(struct bit_writer *bw, unsigned int len, unsigned int dist)
+{
+	unsigned int i;
+
+	for (i = ARRAY_SIZE(length_base) - 1; length_base[i] > len; i--) {
+	}
+
+	put_symbol(bw, 257 + i);
+	put_bits(bw, len - length_base[i], length_extra[i]);
+
+	for (i = ARRAY_SIZE(dist_base) - 1; dist_base[i] > dist; i--) {
+	}
+
+	put_code(bw, i, 5);
+	put_bits(bw, dist - dist_base[i], dist_extra[i]);
+}
+
+static inline unsigned int hash3(const uint8_t *p)
+{
+	return ((p[0] << 4) ^ (p[1] << 2) ^ p[2]) & (DEFLATE_HASH_SIZE - 1);
+}
+
+static inline void hash_insert(struct deflate_ctx *ctx, size_t pos, size_t end)
+{
+	if (pos + DEFLATE_MIN_MATCH <= end) {
+		ctx->head[hash3(&ctx->buf[pos])] = pos + 1;
+	}
+}
+
+void deflate_init(struct deflate_ctx *ctx)
+{
+	ctx->hist_len = 0;
+}
+
+APP_HOT_CODE int deflate_compress(struct deflate_ctx *ctx, const uint8_t *in, size_t in_len,
+				  uint8_t *out, size_t out_max)
+{
+	struct bit_writer bw = {
+		.out = out,
+		.max = out_max,
+	};
+	size_t end = ctx->hist_len + in_len;
+	size_t pos;
+
+	if (in_len > DEFLATE_MAX_INPUT) {
+		return -EINVAL;
+	}
+
+	memcpy(&ctx->buf[ctx->hist_len], in, in_len);
+
+	/* Positions are only valid for the current buffer layout, which
+	 * changes every message as the history slides, so the table is
+	 * rebuilt from the history rather than kept.
+	 */
+	memset(ctx->head, 0, sizeof(ctx->head));
+	for (pos = 0; pos < ctx->hist_len; pos++) {
+		hash_insert(ctx, pos, end);
+	}
+
+	/* BFINAL = 0, BTYPE = 01 (fixed Huffman) */
+	put_bits(&bw, 0x2, 3);
+
+	while (pos < end) {
+		unsigned int cand = 0;
+		size_t len = 0;
+
+		if (pos + DEFLATE_MIN_MATCH <= end) {
+			cand = ctx->head[hash3(&ctx->buf[pos])];
+		}
+
+		if (cand != 0 && pos - (cand - 1) <= DEFLATE_WINDOW) {
+			size_t max = MIN(end - pos, DEFLATE_MAX_MATCH);
+
+			cand--;
+			while (len < max && ctx->buf[cand + len] == ctx->buf[pos + len]) {
+				len++;
+			}
+		}
+
+		if (len >= DEFLATE_MIN_MATCH) {
+			put_match(&bw, len, pos - cand);
+			for (size_t i = 0; i < len; i++) {
+				hash_insert(ctx, pos + i, end);
+			}
+			pos += len;
+		} else {
+			put_symbol(&bw, ctx->buf[pos]);
+			hash_insert(ctx, pos, end);
+			pos++;
+		}
+	}
+
+	/* End of block, then sync flush: empty stored block, byte aligned */
+	put_symbol(&bw, 256);
+	put_bits(&bw, 0, 3);
+	if (bw.count > 0) {
+		put_bits(&bw, 0, 8 - bw.count);
+	}
+	put_bits(&bw, 0x0000, 16);
+	put_bits(&bw, 0xffff, 16);
+
+	if (bw.overflow) {
+		return -ENOSPC;
+	}
+
+	/* Keep the tail of the data as history for the next message */
+	if (end > DEFLATE_WINDOW) {
+		memmove(ctx->buf, &ctx->buf[end - DEFLATE_WINDOW], DEFLATE_WINDOW);
+		ctx->hist_len = DEFLATE_WINDOW;
+	} else {
+		ctx->hist_len = end;
+	}
+
+	return bw.len;
+}
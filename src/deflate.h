@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_DEFLATE_H_
+#define APP_DEFLATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Largest message accepted by deflate_compress() */
+#define DEFLATE_MAX_INPUT 256
+
+/** Number of entries of the match finder hash table */
+#define DEFLATE_HASH_SIZE 256
+
+/** Worst case output size for an input of the given length */
+#define DEFLATE_BOUND(len) ((len) + ((len) >> 3) + 16)
+
+struct deflate_ctx;
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE_WINDOW)
+/**
+ * @brief Streaming raw DEFLATE compressor with a small sliding window
+ *
+ * Every message is compressed into fixed Huffman blocks terminated by a sync
+ * flush (empty stored block), so the receiver can decode each message as soon
+ * as it arrives. Matches may refer to up to
+ * CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE_WINDOW bytes of previous messages,
+ * which is where repetitive telemetry gains the most.
+ */
+struct deflate_ctx {
+	uint8_t buf[CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE_WINDOW + DEFLATE_MAX_INPUT];
+	uint16_t head[DEFLATE_HASH_SIZE];
+	size_t hist_len;
+};
+#endif /* CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE_WINDOW */
+
+/**
+ * @brief Reset the compressor, dropping the history
+ *
+ * @param ctx Compressor context
+ */
+void deflate_init(struct deflate_ctx *ctx);
+
+/**
+ * @brief Compress one message
+ *
+ * @param ctx Compressor context
+ * @param in Message to compress
+ * @param in_len Length of the message, at most DEFLATE_MAX_INPUT
+ * @param out Output buffer
+ * @param out_max Size of the output buffer, DEFLATE_BOUND(in_len) is always
+ *		  enough
+ *
+ * @return Length of the compressed data on success, -EINVAL if the message
+ *	   is too long, -ENOSPC if the output buffer is too small
+ */
+int deflate_compress(struct deflate_ctx *ctx, const uint8_t *in, size_t in_len, uint8_t *out,
+		     size_t out_max);
+
+#endif /* APP_DEFLATE_H_ */
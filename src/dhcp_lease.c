@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/dhcpv4.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_mgmt.h>
+#include <zephyr/posix/time.h>
+#include <zephyr/settings/settings.h>
+
+#include "route.h"
+#include "startup.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+/*
+ * The last DHCPv4 lease is kept in settings. At boot the cached address is
+ * configured at once so the HTTP server answers without waiting for the
+ * DHCP exchange, which then runs in the background. Once it binds, the
+ * cached address is withdrawn if the server handed out another one, and the
+ * new lease is saved. The cached address is only a guess until then, so it
+ * is dropped if DHCP does not bind within
+ * CONFIG_NET_SAMPLE_DHCP_LEASE_CONFIRM_TIMEOUT seconds.
+ *
+ * The lease is saved with the realtime clock at which it was granted. When
+ * the clock is set at boot, by an RTC or a previous SNTP sync, a lease that
+ * ran out meanwhile is not used at all.
+ */
+
+#define DHCP_LEASE_KEY "dhcp/lease"
+/* Lease time of a lease that never runs out, RFC 2131 section 3.3 */
+#define DHCP_LEASE_INFINITE 0xffffffffU
+/* 2024-01-01, a realtime clock earlier than this was never set */
+#define DHCP_LEASE_CLOCK_MIN 1704067200LL
+
+struct dhcp_lease {
+	struct in_addr addr;
+	struct in_addr netmask;
+	struct in_addr gw;
+	uint32_t lease_time;
+	/* Realtime clock in seconds when the lease was bound, -1 if unset */
+	int64_t granted;
+};
+
+enum dhcp_lease_source {
+	DHCP_LEASE_NONE,
+	DHCP_LEASE_CACHED,
+	DHCP_LEASE_BOUND,
+};
+
+static const char *const dhcp_lease_source_str[] = {
+	[DHCP_LEASE_NONE] = "none",
+	[DHCP_LEASE_CACHED] = "cached",
+	[DHCP_LEASE_BOUND] = "bound",
+};
+
+static struct net_if *lease_iface;
+static struct dhcp_lease cached_lease;
+/* Written from the net_mgmt event thread, guarded by lease_lock */
+static struct dhcp_lease bound_lease;
+static struct k_spinlock lease_lock;
+static enum dhcp_lease_source lease_source;
+/* Uptime in ms at which an address was first usable and the lease bound */
+static int64_t lease_ready_ms = -1;
+static int64_t lease_bound_ms = -1;
+
+static struct net_mgmt_event_callback dhcp_cb;
+
+/* Realtime clock in seconds, -1 if it was not set since boot */
+static int64_t lease_clock_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_REALTIME, &ts) < 0 || ts.tv_sec < DHCP_LEASE_CLOCK_MIN) {
+		return -1;
+	}
+
+	return ts.tv_sec;
+}
+
+static void lease_save_work_handler(struct k_work *work);
+static void lease_expire_work_handler(struct k_work *work);
+
+static K_WORK_DEFINE(lease_save_work, lease_save_work_handler);
+static K_WORK_DELAYABLE_DEFINE(lease_expire_work, lease_expire_work_handler);
+
+static int dhcp_lease_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	ssize_t ret;
+
+	if (!settings_name_steq(name, "lease", &next) || next != NULL) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(cached_lease)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &cached_lease, sizeof(cached_lease));
+	if (ret < 0) {
+		return ret;
+	}
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(dhcp, "dhcp", NULL, dhcp_lease_set, NULL, NULL);
+
+static void lease_save_work_handler(struct k_work *work)
+{
+	struct dhcp_lease lease;
+	k_spinlock_key_t key;
+	int ret;
+
+	ARG_UNUSED(work);
+
+	key = k_spin_lock(&lease_lock);
+	lease = bound_lease;
+	k_spin_unlock(&lease_lock, key);
+
+	/* Renewals hand out the same lease again, only write flash on change.
+	 * With the realtime clock set, every renewal moves the grant time.
+	 */
+	if (memcmp(&lease, &cached_lease, sizeof(lease)) == 0) {
+		return;
+	}
+
+	ret = settings_save_one(DHCP_LEASE_KEY, &lease, sizeof(lease));
+	if (ret < 0) {
+		LOG_ERR("Failed to save DHCP lease (%d)", ret);
+		return;
+	}
+
+	cached_lease = lease;
+}
+
+static void lease_expire_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	LOG_WRN("No DHCP server confirmed %s, dropping it",
+		net_sprint_ipv4_addr(&cached_lease.addr));
+
+	(void)net_if_ipv4_addr_rm(lease_iface, &cached_lease.addr);
+	lease_source = DHCP_LEASE_NONE;
+}
+
+static void dhcp_bound(struct net_if *iface)
+{
+	struct net_if_dhcpv4 *dhcpv4 = &iface->config.dhcpv4;
+	struct dhcp_lease lease;
+	k_spinlock_key_t key;
+
+	(void)k_work_cancel_delayable(&lease_expire_work);
+
+	lease.addr = dhcpv4->requested_ip;
+	lease.netmask = net_if_ipv4_get_netmask_by_addr(iface, &dhcpv4->requested_ip);
+	lease.gw = iface->config.ip.ipv4->gw;
+	lease.lease_time = dhcpv4->lease_time;
+	lease.granted = lease_clock_now();
+
+	key = k_spin_lock(&lease_lock);
+	bound_lease = lease;
+	k_spin_unlock(&lease_lock, key);
+
+	if (lease_source == DHCP_LEASE_CACHED &&
+	    !net_ipv4_addr_cmp(&cached_lease.addr, &lease.addr)) {
+		LOG_WRN("DHCP server moved us from %s", net_sprint_ipv4_addr(&cached_lease.addr));
+		(void)net_if_ipv4_addr_rm(iface, &cached_lease.addr);
+	}
+
+	if (lease_ready_ms < 0) {
+		lease_ready_ms = k_uptime_get();
+	}
+
+	if (lease_bound_ms < 0) {
+		lease_bound_ms = k_uptime_get();
+		LOG_INF("DHCP bound %s after %lld ms", net_sprint_ipv4_addr(&lease.addr),
+			(long long)lease_bound_ms);
+	}
+
+	lease_source = DHCP_LEASE_BOUND;
+
+	k_work_submit(&lease_save_work);
+}
+
+static void dhcp_event_handler(struct net_mgmt_event_callback *cb, uint32_t mgmt_event,
+			       struct net_if *iface)
+{
+	ARG_UNUSED(cb);
+
+	if (mgmt_event == NET_EVENT_IPV4_DHCP_BOUND) {
+		dhcp_bound(iface);
+	}
+}
+
+static bool lease_valid(const struct dhcp_lease *lease)
+{
+	return lease->lease_time > 0 && !net_ipv4_is_addr_unspecified(&lease->addr) &&
+	       !net_ipv4_is_addr_bcast(lease_iface, &lease->addr);
+}
+
+/* Seconds left on a lease, as far as the realtime clock tells */
+static int64_t lease_remaining(const struct dhcp_lease *lease)
+{
+	int64_t now;
+
+	if (lease->lease_time == DHCP_LEASE_INFINITE) {
+		return INT64_MAX;
+	}
+
+	now = lease_clock_now();
+	if (now < 0 || lease->granted < 0) {
+		/* No way to tell how long the device was off */
+		return lease->lease_time;
+	}
+
+	return lease->granted + lease->lease_time - now;
+}
+
+static void lease_apply_cached(void)
+{
+	struct net_if_addr *ifaddr;
+	int64_t remaining;
+
+	remaining = lease_remaining(&cached_lease);
+	if (remaining <= 0) {
+		LOG_INF("Cached lease %s ran out", net_sprint_ipv4_addr(&cached_lease.addr));
+		return;
+	}
+
+	ifaddr = net_if_ipv4_addr_add(lease_iface, &cached_lease.addr, NET_ADDR_MANUAL, 0);
+	if (ifaddr == NULL) {
+		LOG_ERR("Cannot add cached address %s", net_sprint_ipv4_addr(&cached_lease.addr));
+		return;
+	}
+
+	net_if_ipv4_set_netmask_by_addr(lease_iface, &cached_lease.addr, &cached_lease.netmask);
+	net_if_ipv4_set_gw(lease_iface, &cached_lease.gw);
+
+	lease_source = DHCP_LEASE_CACHED;
+	lease_ready_ms = k_uptime_get();
+
+	/* Another host may hold the address by now, it is only kept while
+	 * the DHCP client gets it confirmed
+	 */
+	remaining = MIN(remaining, CONFIG_NET_SAMPLE_DHCP_LEASE_CONFIRM_TIMEOUT);
+	k_work_schedule(&lease_expire_work, K_SECONDS(remaining));
+
+	LOG_INF("Serving on cached lease %s", net_sprint_ipv4_addr(&cached_lease.addr));
+}
+
+static int dhcp_lease_init(void)
+{
+	int ret;
+
+	lease_iface = net_if_get_default();
+	if (lease_iface == NULL) {
+		return -ENODEV;
+	}
+
+	ret = settings_subsys_init();
+	if (ret < 0) {
+		LOG_ERR("Settings unavailable (%d), no cached lease", ret);
+	} else {
+		(void)settings_load_subtree("dhcp");
+	}
+
+	if (lease_valid(&cached_lease)) {
+		lease_apply_cached();
+	}
+
+	net_mgmt_init_event_callback(&dhcp_cb, dhcp_event_handler, NET_EVENT_IPV4_DHCP_BOUND);
+	net_mgmt_add_event_callback(&dhcp_cb);
+
+	net_dhcpv4_start(lease_iface);
+
+	return 0;
+}
+
+STARTUP_TASK_DEFINE(dhcp_lease, STARTUP_DHCP_LEASE, 0, dhcp_lease_init);
+
+static int dhcp_lease_handler(struct http_client_ctx *client, enum http_data_status status,
+			      const struct http_request_ctx *request_ctx,
+			      struct http_response_ctx *response_ctx,
+			      const struct route_params *params)
+{
+	static char json_buf[128];
+	k_spinlock_key_t key;
+	struct in_addr addr;
+	int len;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	key = k_spin_lock(&lease_lock);
+	addr = lease_source == DHCP_LEASE_BOUND ? bound_lease.addr : cached_lease.addr;
+	k_spin_unlock(&lease_lock, key);
+
+	len = snprintf(json_buf, sizeof(json_buf),
+		       "{\"source\":\"%s\",\"addr\":\"%s\",\"ready_ms\":%lld,\"bound_ms\":%lld}",
+		       dhcp_lease_source_str[lease_source],
+		       lease_source == DHCP_LEASE_NONE ? "" : net_sprint_ipv4_addr(&addr),
+		       (long long)lease_ready_ms, (long long)lease_bound_ms);
+	if (len >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = len;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(dhcp_lease_route, "/stats/dhcp", BIT(HTTP_GET), dhcp_lease_handler);
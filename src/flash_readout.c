@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/http/service.h>
+#include <zephyr/storage/flash_map.h>
+
+#if defined(CONFIG_FLASH_SIMULATOR)
+#include <zephyr/drivers/flash/flash_simulator.h>
+#endif
+
+#include "conn_state.h"
+#include "http_auth.h"
+#include "route.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+/*
+ * GET /flash/{partition} streams a fixed partition, with a single byte
+ * range if asked for. Chunks are sent straight from memory mapped flash:
+ * the response body points into the flash address space and no RAM copy
+ * is made before the TCP stack takes the data.
+ */
+
+HTTP_SERVER_REGISTER_HEADER_CAPTURE(readout_range, "Range");
+
+struct readout_partition {
+	const char *name;
+	uint8_t id;
+};
+
+#define READOUT_PARTITION(label)                                                                   \
+	COND_CODE_1(FIXED_PARTITION_EXISTS(label),                                                 \
+		    ({.name = #label, .id = FIXED_PARTITION_ID(label)},), ())
+
+static const struct readout_partition readout_partitions[] = {
+	READOUT_PARTITION(slot0_partition)
+	READOUT_PARTITION(slot1_partition)
+	READOUT_PARTITION(lfs1_partition)
+	READOUT_PARTITION(storage_partition)
+	READOUT_PARTITION(settings_partition)
+	READOUT_PARTITION(coredump_partition)
+};
+
+/* Content-Range of the response in progress, sent before the next callback */
+static char readout_content_range[48];
+
+static const struct http_header readout_headers[] = {
+	{.name = "Content-Type", .value = "application/octet-stream"},
+	{.name = "Accept-Ranges", .value = "bytes"},
+};
+
+static const struct http_header readout_range_headers[] = {
+	{.name = "Content-Type", .value = "application/octet-stream"},
+	{.name = "Content-Range", .value = readout_content_range},
+};
+
+static const uint8_t *readout_map(const struct flash_area *fa)
+{
+#if defined(CONFIG_FLASH_SIMULATOR)
+	size_t size;
+
+	return (const uint8_t *)flash_simulator_get_memory(fa->fa_dev, &size) + fa->fa_off;
+#else
+	if (fa->fa_dev != DEVICE_DT_GET(DT_CHOSEN(zephyr_flash_controller))) {
+		return NULL;
+	}
+
+	return (const uint8_t *)DT_REG_ADDR(DT_CHOSEN(zephyr_flash)) + fa->fa_off;
+#endif
+}
+
+/*
+ * Parse "bytes=first-last", "bytes=first-" or "bytes=-suffix" into
+ * [*start, *end). Returns 1 for a range, 0 to serve it all and -ERANGE if
+ * unsatisfiable. Other forms, such as several ranges, are ignored.
+ */
+static int readout_range_parse(const char *value, size_t size, size_t *start, size_t *end)
+{
+	unsigned long first, last;
+	char *next;
+
+	if (value == NULL || strncmp(value, "bytes=", 6) != 0) {
+		return 0;
+	}
+
+	value += 6;
+
+	if (*value == '-') {
+		last = strtoul(value + 1, &next, 10);
+		if (next == value + 1 || *next != '\0') {
+			return 0;
+		}
+
+		if (last == 0) {
+			return -ERANGE;
+		}
+
+		*start = size - MIN(last, size);
+		*end = size;
+		return 1;
+	}
+
+	first = strtoul(value, &next, 10);
+	if (next == value || *next != '-') {
+		return 0;
+	}
+
+	value = next + 1;
+	if (*value == '\0') {
+		last = size - 1;
+	} else {
+		last = strtoul(value, &next, 10);
+		if (*next != '\0' || last < first) {
+			return 0;
+		}
+	}
+
+	if (first >= size) {
+		return -ERANGE;
+	}
+
+	*start = first;
+	*end = MIN(last, size - 1) + 1;
+	return 1;
+}
+
+static const struct readout_partition *readout_find(const struct route_param *name)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(readout_partitions); i++) {
+		if (strlen(readout_partitions[i].name) == name->value_len &&
+		    strncmp(readout_partitions[i].name, name->value, name->value_len) == 0) {
+			return &readout_partitions[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int readout_begin(struct conn_state *state, const struct http_request_ctx *request_ctx,
+			 struct http_response_ctx *response_ctx, const struct flash_area *fa)
+{
+	size_t size = fa->fa_size;
+	size_t start = 0;
+	int ret;
+
+	if (request_ctx->headers_status != HTTP_HEADER_STATUS_OK) {
+		LOG_WRN("Request headers not all captured (%d)", request_ctx->headers_status);
+	}
+
+	state->end = size;
+
+	ret = readout_range_parse(http_auth_header(request_ctx, "Range"), size, &start,
+				  &state->end);
+	if (ret < 0) {
+		snprintf(readout_content_range, sizeof(readout_content_range), "bytes */%zu", size);
+		response_ctx->status = HTTP_416_RANGE_NOT_SATISFIABLE;
+		response_ctx->headers = readout_range_headers;
+		response_ctx->header_count = ARRAY_SIZE(readout_range_headers);
+		return ret;
+	}
+
+	state->offset = start;
+
+	if (ret > 0) {
+		snprintf(readout_content_range, sizeof(readout_content_range), "bytes %zu-%zu/%zu",
+			 start, state->end - 1, size);
+		response_ctx->status = HTTP_206_PARTIAL_CONTENT;
+		response_ctx->headers = readout_range_headers;
+		response_ctx->header_count = ARRAY_SIZE(readout_range_headers);
+	} else {
+		response_ctx->headers = readout_headers;
+		response_ctx->header_count = ARRAY_SIZE(readout_headers);
+	}
+
+	return 0;
+}
+
+static int flash_readout_handler(struct http_client_ctx *client, enum http_data_status status,
+				 const struct http_request_ctx *request_ctx,
+				 struct http_response_ctx *response_ctx,
+				 const struct route_params *params)
+{
+	const struct readout_partition *part;
+	const struct flash_area *fa;
+	const uint8_t *map;
+	struct conn_state *state;
+	size_t len;
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	/* Owned and released by route_dispatch() */
+	state = conn_state_get(client);
+	if (state == NULL) {
+		return -ENOMEM;
+	}
+
+	if (!state->responding && !http_auth_bearer_ok(request_ctx)) {
+		response_ctx->status = HTTP_401_UNAUTHORIZED;
+		response_ctx->headers = &http_auth_challenge_header;
+		response_ctx->header_count = 1;
+		response_ctx->final_chunk = true;
+		return 0;
+	}
+
+	/* Looked up again for every chunk, opening a fixed partition is cheap */
+	part = readout_find(route_param_get(params, "partition"));
+	if (part == NULL || flash_area_open(part->id, &fa) < 0) {
+		response_ctx->status = HTTP_404_NOT_FOUND;
+		response_ctx->final_chunk = true;
+		return 0;
+	}
+
+	map = readout_map(fa);
+	if (map == NULL) {
+		/* Not memory mapped, such as a partition of an external SPI flash */
+		response_ctx->status = HTTP_501_NOT_IMPLEMENTED;
+		response_ctx->final_chunk = true;
+		goto out;
+	}
+
+	if (!state->responding) {
+		ret = readout_begin(state, request_ctx, response_ctx, fa);
+		if (ret < 0) {
+			response_ctx->final_chunk = true;
+			goto out;
+		}
+	}
+
+	len = MIN(CONFIG_NET_SAMPLE_FLASH_READOUT_CHUNK, state->end - state->offset);
+
+	response_ctx->body = map + state->offset;
+	response_ctx->body_len = len;
+
+	state->offset += len;
+	response_ctx->final_chunk = state->offset >= state->end;
+
+out:
+	flash_area_close(fa);
+
+	return 0;
+}
+
+ROUTE_DEFINE(flash_readout_route, "/flash/{partition}", BIT(HTTP_GET), flash_readout_handler);
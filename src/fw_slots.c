@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <app_version.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "fw_slots.h"
+#include "route.h"
+#include "startup.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+/* MCUboot image format, see bootutil/image.h */
+#define IMAGE_MAGIC          0x96f3b83d
+#define IMAGE_TLV_INFO_MAGIC 0x6907
+#define IMAGE_TLV_SHA256     0x10
+
+struct image_header {
+	uint32_t magic;
+	uint32_t load_addr;
+	uint16_t hdr_size;
+	uint16_t protect_tlv_size;
+	uint32_t img_size;
+	uint32_t flags;
+	uint8_t ver_major;
+	uint8_t ver_minor;
+	uint16_t ver_revision;
+	uint32_t ver_build_num;
+	uint32_t pad;
+} __packed;
+
+struct image_tlv_info {
+	uint16_t magic;
+	uint16_t tlv_tot;
+} __packed;
+
+struct image_tlv {
+	uint8_t type;
+	uint8_t pad;
+	uint16_t len;
+} __packed;
+
+#define FW_SLOT_HASH_LEN 32
+/* Longest "major.minor.revision+build" of an MCUboot image header */
+#define FW_SLOT_VERSION_MAX "255.255.65535+4294967295"
+
+struct fw_slot {
+	bool valid;
+	bool confirmed;
+	bool pending;
+	/* The flash contents match the SHA-256 TLV */
+	bool verified;
+	uint32_t size;
+	char version[sizeof(FW_SLOT_VERSION_MAX)];
+	char hash[2 * FW_SLOT_HASH_LEN + 1];
+};
+
+static const uint8_t fw_slot_area[] = {
+	FIXED_PARTITION_ID(slot0_partition),
+	FIXED_PARTITION_ID(slot1_partition),
+};
+
+static struct fw_slot fw_slots[ARRAY_SIZE(fw_slot_area)];
+static struct k_spinlock fw_slots_lock;
+/* Refreshes come from the startup task and the upload paths, one at a time
+ * as they share the read buffer of fw_slot_verify()
+ */
+static K_MUTEX_DEFINE(fw_slots_read_lock);
+
+/* Find the SHA-256 in the unprotected TLV area, which follows the image and
+ * its protected TLVs
+ */
+static int fw_slot_read_hash(const struct flash_area *fa, const struct image_header *hdr,
+			     uint8_t hash[FW_SLOT_HASH_LEN])
+{
+	struct image_tlv_info info;
+	struct image_tlv tlv;
+	off_t off = sys_le16_to_cpu(hdr->hdr_size) + sys_le32_to_cpu(hdr->img_size) +
+		    sys_le16_to_cpu(hdr->protect_tlv_size);
+	off_t end;
+	int ret;
+
+	ret = flash_area_read(fa, off, &info, sizeof(info));
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (sys_le16_to_cpu(info.magic) != IMAGE_TLV_INFO_MAGIC) {
+		return -ENOENT;
+	}
+
+	end = off + sys_le16_to_cpu(info.tlv_tot);
+	off += sizeof(info);
+
+	while (off + sizeof(tlv) <= end) {
+		ret = flash_area_read(fa, off, &tlv, sizeof(tlv));
+		if (ret < 0) {
+			return ret;
+		}
+
+		off += sizeof(tlv);
+
+		if (tlv.type == IMAGE_TLV_SHA256 && sys_le16_to_cpu(tlv.len) == FW_SLOT_HASH_LEN) {
+			return flash_area_read(fa, off, hash, FW_SLOT_HASH_LEN);
+		}
+
+		off += sys_le16_to_cpu(tlv.len);
+	}
+
+	return -ENOENT;
+}
+
+#if defined(CONFIG_FLASH_AREA_CHECK_INTEGRITY)
+/* Hash what MCUboot hashes, the header, the image and the protected TLVs,
+ * and compare with the hash the image claims
+ */
+static bool fw_slot_verify(const struct flash_area *fa, const struct image_header *hdr,
+			   const uint8_t hash[FW_SLOT_HASH_LEN])
+{
+	static uint8_t rbuf[256];
+	struct flash_area_check fac = {
+		.match = hash,
+		.clen = sys_le16_to_cpu(hdr->hdr_size) + sys_le32_to_cpu(hdr->img_size) +
+			sys_le16_to_cpu(hdr->protect_tlv_size),
+		.off = 0,
+		.rbuf = rbuf,
+		.rblen = sizeof(rbuf),
+	};
+
+	return flash_area_check_int_sha256(fa, &fac) == 0;
+}
+#endif
+
+void fw_slots_invalidate(uint8_t slot)
+{
+	k_spinlock_key_t key;
+
+	if (slot >= ARRAY_SIZE(fw_slots)) {
+		return;
+	}
+
+	key = k_spin_lock(&fw_slots_lock);
+	memset(&fw_slots[slot], 0, sizeof(fw_slots[slot]));
+	k_spin_unlock(&fw_slots_lock, key);
+}
+
+int fw_slots_refresh(uint8_t slot)
+{
+	uint8_t hash[FW_SLOT_HASH_LEN];
+	const struct flash_area *fa;
+	struct image_header hdr;
+	struct fw_slot entry = {0};
+	k_spinlock_key_t key;
+	int swap_type;
+	int ret;
+
+	if (slot >= ARRAY_SIZE(fw_slot_area)) {
+		return -EINVAL;
+	}
+
+	ret = flash_area_open(fw_slot_area[slot], &fa);
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_mutex_lock(&fw_slots_read_lock, K_FOREVER);
+
+	ret = flash_area_read(fa, 0, &hdr, sizeof(hdr));
+	if (ret < 0) {
+		goto out;
+	}
+
+	if (sys_le32_to_cpu(hdr.magic) != IMAGE_MAGIC) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	ret = fw_slot_read_hash(fa, &hdr, hash);
+	if (ret < 0) {
+		goto out;
+	}
+
+	entry.valid = true;
+	entry.size = sys_le32_to_cpu(hdr.img_size);
+	snprintf(entry.version, sizeof(entry.version), "%u.%u.%u+%u", hdr.ver_major,
+		 hdr.ver_minor, sys_le16_to_cpu(hdr.ver_revision),
+		 (unsigned int)sys_le32_to_cpu(hdr.ver_build_num));
+	bin2hex(hash, sizeof(hash), entry.hash, sizeof(entry.hash));
+#if defined(CONFIG_FLASH_AREA_CHECK_INTEGRITY)
+	entry.verified = fw_slot_verify(fa, &hdr, hash);
+#endif
+
+	if (slot == 0) {
+		entry.confirmed = boot_is_img_confirmed();
+	} else {
+		swap_type = mcuboot_swap_type();
+		entry.pending = swap_type == BOOT_SWAP_TYPE_TEST ||
+				swap_type == BOOT_SWAP_TYPE_PERM;
+	}
+
+out:
+	k_mutex_unlock(&fw_slots_read_lock);
+	flash_area_close(fa);
+
+	key = k_spin_lock(&fw_slots_lock);
+	fw_slots[slot] = entry;
+	k_spin_unlock(&fw_slots_lock, key);
+
+	if (ret < 0 && ret != -ENOENT) {
+		LOG_ERR("Failed to read slot %u image, err %d", slot, ret);
+	}
+
+	return ret;
+}
+
+static int fw_slots_init(void)
+{
+	for (uint8_t slot = 0; slot < ARRAY_SIZE(fw_slots); slot++) {
+		(void)fw_slots_refresh(slot);
+	}
+
+	return 0;
+}
+/* After the boot time upgrade request, which changes the slot 1 flags */
+STARTUP_TASK_DEFINE(fw_slots, STARTUP_FW_SLOTS, BIT(STARTUP_BOOT_REQUEST), fw_slots_init);
+
+#if defined(CONFIG_FLASH_AREA_CHECK_INTEGRITY)
+#define FW_SLOT_VERIFIED(slot) ((slot)->verified ? "true" : "false")
+#else
+/* Not known without a SHA-256 implementation */
+#define FW_SLOT_VERIFIED(slot) "null"
+#endif
+
+static int fw_slots_handler(struct http_client_ctx *client, enum http_data_status status,
+			    const struct http_request_ctx *request_ctx,
+			    struct http_response_ctx *response_ctx,
+			    const struct route_params *params)
+{
+	static char json_buf[96 + 224 * ARRAY_SIZE(fw_slots)];
+	struct fw_slot slots[ARRAY_SIZE(fw_slots)];
+	k_spinlock_key_t key;
+	size_t len;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	key = k_spin_lock(&fw_slots_lock);
+	memcpy(slots, fw_slots, sizeof(slots));
+	k_spin_unlock(&fw_slots_lock, key);
+
+	len = snprintf(json_buf, sizeof(json_buf), "{\"running\":\"%s\",\"slots\":[",
+		       APP_VERSION_EXTENDED_STRING);
+
+	for (size_t i = 0; i < ARRAY_SIZE(slots) && len < sizeof(json_buf); i++) {
+		if (!slots[i].valid) {
+			len += snprintf(&json_buf[len], sizeof(json_buf) - len,
+					"%s{\"slot\":%zu,\"valid\":false}", i > 0 ? "," : "", i);
+			continue;
+		}
+
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len,
+				"%s{\"slot\":%zu,\"valid\":true,\"version\":\"%s\",\"size\":%u,"
+				"\"tlv_sha256\":\"%s\",\"verified\":%s,\"confirmed\":%s,"
+				"\"pending\":%s}",
+				i > 0 ? "," : "", i, slots[i].version, (unsigned int)slots[i].size,
+				slots[i].hash, FW_SLOT_VERIFIED(&slots[i]),
+				slots[i].confirmed ? "true" : "false",
+				slots[i].pending ? "true" : "false");
+	}
+
+	if (len < sizeof(json_buf)) {
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len, "]}");
+	}
+
+	if (len >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = len;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(fw_slots_route, "/fw/slots", BIT(HTTP_GET), fw_slots_handler);
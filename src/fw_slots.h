@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_FW_SLOTS_H_
+#define APP_FW_SLOTS_H_
+
+#include <stdint.h>
+
+/*
+ * What the MCUboot slots hold is read once and cached: the image version
+ * and size from the image header, and the SHA-256 MCUboot checks at boot
+ * from the TLV area. That hash is only what the image claims, so it is
+ * also checked against the flash contents when
+ * CONFIG_FLASH_AREA_CHECK_INTEGRITY is enabled. /fw/slots serves the cache
+ * without touching flash.
+ */
+
+/**
+ * @brief Mark a slot as holding no valid image
+ *
+ * Called when an upload starts overwriting slot 1.
+ *
+ * @param slot 0 for the running image, 1 for the upgrade slot
+ */
+void fw_slots_invalidate(uint8_t slot);
+
+/**
+ * @brief Read the image header and TLVs of a slot again
+ *
+ * Called at boot, and after an upload wrote slot 1. Hashing the image to
+ * verify it takes a read of the whole slot.
+ *
+ * @param slot 0 for the running image, 1 for the upgrade slot
+ *
+ * @return 0 on success, -ENOENT if the slot holds no valid image, negative
+ *         errno on flash errors
+ */
+int fw_slots_refresh(uint8_t slot);
+
+#endif /* APP_FW_SLOTS_H_ */
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/dfu/flash_img.h>
+#include <zephyr/dfu/mcuboot.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/websocket.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "fw_slots.h"
+#include "fw_upload.h"
+#include "http_auth.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define FW_DATA_HDR_LEN (1 + sizeof(uint32_t))
+#define FW_CHUNK_SIZE CONFIG_NET_SAMPLE_FW_UPLOAD_CHUNK
+#define FW_WINDOW CONFIG_NET_SAMPLE_FW_UPLOAD_WINDOW
+
+/* Only one upload, over websocket or POST, may write slot1 at a time */
+static atomic_t fw_busy;
+
+static struct flash_img_context fw_img;
+static size_t fw_total;
+static int64_t fw_start;
+
+static int fw_begin(size_t total)
+{
+	int ret;
+
+	ret = flash_img_init(&fw_img);
+	if (ret < 0) {
+		LOG_ERR("Failed to open upload slot, err %d", ret);
+		return ret;
+	}
+
+	if (total > fw_img.flash_area->fa_size) {
+		LOG_ERR("Image of %zu bytes does not fit in slot", total);
+		return -EFBIG;
+	}
+
+	fw_total = total;
+	fw_start = k_uptime_get();
+
+#if defined(CONFIG_NET_SAMPLE_FW_SLOTS)
+	/* Slot 1 is erased as it is written, whatever it held is gone */
+	fw_slots_invalidate(1);
+#endif
+
+	LOG_INF("Receiving %zu byte image", total);
+
+	return 0;
+}
+
+static int fw_finish(void)
+{
+	size_t written;
+	int ret;
+
+	ret = flash_img_buffered_write(&fw_img, NULL, 0, true);
+	if (ret < 0) {
+		LOG_ERR("Failed to flush image, err %d", ret);
+		return ret;
+	}
+
+	written = flash_img_bytes_written(&fw_img);
+	if (fw_total != 0 && written != fw_total) {
+		LOG_ERR("Image truncated, %zu of %zu bytes", written, fw_total);
+		return -EIO;
+	}
+
+	LOG_INF("Image of %zu bytes written in %lld ms", written, k_uptime_get() - fw_start);
+
+	ret = boot_request_upgrade(BOOT_UPGRADE_TEST);
+	if (ret < 0) {
+		LOG_ERR("Failed to request upgrade, err %d", ret);
+		return ret;
+	}
+
+#if defined(CONFIG_NET_SAMPLE_FW_SLOTS)
+	(void)fw_slots_refresh(1);
+#endif
+
+	return 0;
+}
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE)
+#define FW_RX_STACK_SIZE 2048
+#define FW_WRITER_STACK_SIZE 1536
+#define FW_THREAD_PRIORITY K_PRIO_PREEMPT(8)
+
+/* Chunks travel from the receiving thread to the flash writer thread, so
+ * flash programming of one chunk overlaps with the reception of the next
+ * ones. The window size bounds the buffers, and the client is told not to
+ * have more chunks in flight than that.
+ */
+struct fw_chunk {
+	void *fifo_reserved;
+	size_t len;
+	uint8_t msg[FW_DATA_HDR_LEN + FW_CHUNK_SIZE];
+};
+
+K_MEM_SLAB_DEFINE_STATIC(fw_chunk_slab, sizeof(struct fw_chunk), FW_WINDOW, sizeof(void *));
+static K_FIFO_DEFINE(fw_chunk_fifo);
+
+K_THREAD_STACK_DEFINE(fw_rx_stack, FW_RX_STACK_SIZE);
+static struct k_thread fw_rx_thread;
+static bool fw_rx_started;
+
+static int fw_sock = -1;
+/* Written by the receiving and the flash writer threads, which may run on
+ * different CPUs
+ */
+static atomic_t fw_status;
+static K_MUTEX_DEFINE(fw_tx_lock);
+
+static int fw_send(const uint8_t *msg, size_t len)
+{
+	int ret;
+
+	k_mutex_lock(&fw_tx_lock, K_FOREVER);
+	ret = websocket_send_msg(fw_sock, msg, len, WEBSOCKET_OPCODE_DATA_BINARY, false, true,
+				 CONFIG_NET_SAMPLE_FW_UPLOAD_TIMEOUT);
+	k_mutex_unlock(&fw_tx_lock);
+
+	return ret;
+}
+
+static void fw_send_done(int status)
+{
+	uint8_t msg[1 + 3 * sizeof(uint32_t)];
+
+	msg[0] = FW_MSG_DONE;
+	sys_put_le32((uint32_t)status, &msg[1]);
+	sys_put_le32(flash_img_bytes_written(&fw_img), &msg[5]);
+	sys_put_le32((uint32_t)(k_uptime_get() - fw_start), &msg[9]);
+
+	(void)fw_send(msg, sizeof(msg));
+}
+
+static void fw_writer(void *p1, void *p2, void *p3)
+{
+	struct fw_chunk *chunk;
+	uint8_t ack[1 + 2 * sizeof(uint32_t)];
+	uint32_t seq;
+	int ret;
+
+	while (true) {
+		chunk = k_fifo_get(&fw_chunk_fifo, K_FOREVER);
+
+		if (atomic_get(&fw_status) < 0) {
+			/* Drop whatever was queued after a failure */
+			k_mem_slab_free(&fw_chunk_slab, chunk);
+			continue;
+		}
+
+		if (chunk->msg[0] == FW_MSG_END) {
+			k_mem_slab_free(&fw_chunk_slab, chunk);
+			ret = fw_finish();
+			atomic_set(&fw_status, ret);
+			fw_send_done(ret);
+			continue;
+		}
+
+		seq = sys_get_le32(&chunk->msg[1]);
+		ret = flash_img_buffered_write(&fw_img, &chunk->msg[FW_DATA_HDR_LEN],
+					       chunk->len - FW_DATA_HDR_LEN, false);
+
+		/* Free the buffer before acknowledging so that the chunk the
+		 * client sends in response always finds one.
+		 */
+		k_mem_slab_free(&fw_chunk_slab, chunk);
+
+		if (ret < 0) {
+			LOG_ERR("Failed to write chunk %u, err %d", seq, ret);
+			atomic_set(&fw_status, ret);
+			fw_send_done(ret);
+			continue;
+		}
+
+		ack[0] = FW_MSG_ACK;
+		sys_put_le32(seq, &ack[1]);
+		sys_put_le32(flash_img_bytes_written(&fw_img), &ack[5]);
+		(void)fw_send(ack, sizeof(ack));
+	}
+}
+
+K_THREAD_DEFINE(fw_writer_tid, FW_WRITER_STACK_SIZE, fw_writer, NULL, NULL, NULL,
+		FW_THREAD_PRIORITY, 0, 0);
+
+/* Read one complete message, skipping control frames */
+static int fw_recv_msg(uint8_t *buf, size_t size, size_t *len)
+{
+	uint32_t message_type;
+	uint64_t remaining;
+	size_t total = 0;
+	int ret;
+
+	do {
+		if (total == size) {
+			return -EMSGSIZE;
+		}
+
+		ret = websocket_recv_msg(fw_sock, buf + total, size - total, &message_type,
+					 &remaining, CONFIG_NET_SAMPLE_FW_UPLOAD_TIMEOUT);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_CLOSE) {
+			return -ECONNRESET;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_PING) {
+			k_mutex_lock(&fw_tx_lock, K_FOREVER);
+			(void)websocket_send_msg(fw_sock, buf + total, ret, WEBSOCKET_OPCODE_PONG,
+						 false, true, CONFIG_NET_SAMPLE_FW_UPLOAD_TIMEOUT);
+			k_mutex_unlock(&fw_tx_lock);
+		}
+
+		if (message_type & (WEBSOCKET_FLAG_PING | WEBSOCKET_FLAG_PONG)) {
+			remaining = 1;
+			continue;
+		}
+
+		total += ret;
+	} while (remaining > 0 || !(message_type & WEBSOCKET_FLAG_FINAL));
+
+	*len = total;
+
+	return 0;
+}
+
+static void fw_rx_handler(void *p1, void *p2, void *p3)
+{
+	uint8_t ready[1 + 2 * sizeof(uint16_t)];
+	struct fw_chunk *chunk;
+	uint32_t next_seq = 0;
+	bool started = false;
+	int ret;
+
+	while (atomic_get(&fw_status) == 0) {
+		ret = k_mem_slab_alloc(&fw_chunk_slab, (void **)&chunk,
+				       K_MSEC(CONFIG_NET_SAMPLE_FW_UPLOAD_TIMEOUT));
+		if (ret < 0) {
+			LOG_ERR("Flash writer stalled");
+			break;
+		}
+
+		ret = fw_recv_msg(chunk->msg, sizeof(chunk->msg), &chunk->len);
+		if (ret < 0 || chunk->len == 0) {
+			k_mem_slab_free(&fw_chunk_slab, chunk);
+			if (ret != -ECONNRESET) {
+				LOG_ERR("Upload connection error %d", ret);
+			}
+			break;
+		}
+
+		switch (chunk->msg[0]) {
+		case FW_MSG_START:
+			ret = (started || chunk->len < 1 + sizeof(uint32_t)) ?
+				-EINVAL : fw_begin(sys_get_le32(&chunk->msg[1]));
+			k_mem_slab_free(&fw_chunk_slab, chunk);
+			if (ret < 0) {
+				atomic_set(&fw_status, ret);
+				fw_send_done(ret);
+				break;
+			}
+
+			started = true;
+			ready[0] = FW_MSG_READY;
+			sys_put_le16(FW_WINDOW, &ready[1]);
+			sys_put_le16(FW_CHUNK_SIZE, &ready[3]);
+			(void)fw_send(ready, sizeof(ready));
+			break;
+
+		case FW_MSG_DATA:
+			if (!started || chunk->len < FW_DATA_HDR_LEN ||
+			    sys_get_le32(&chunk->msg[1]) != next_seq) {
+				LOG_ERR("Unexpected chunk, expected %u", next_seq);
+				k_mem_slab_free(&fw_chunk_slab, chunk);
+				atomic_set(&fw_status, -EINVAL);
+				fw_send_done(-EINVAL);
+				break;
+			}
+
+			next_seq++;
+			k_fifo_put(&fw_chunk_fifo, chunk);
+			break;
+
+		case FW_MSG_END:
+			if (!started) {
+				k_mem_slab_free(&fw_chunk_slab, chunk);
+				atomic_set(&fw_status, -EINVAL);
+				fw_send_done(-EINVAL);
+				break;
+			}
+
+			k_fifo_put(&fw_chunk_fifo, chunk);
+			break;
+
+		default:
+			k_mem_slab_free(&fw_chunk_slab, chunk);
+			break;
+		}
+	}
+
+	/* Let the writer finish with queued chunks before the socket goes */
+	while (k_mem_slab_num_free_get(&fw_chunk_slab) < FW_WINDOW) {
+		k_sleep(K_MSEC(10));
+	}
+
+	k_mutex_lock(&fw_tx_lock, K_FOREVER);
+	(void)websocket_unregister(fw_sock);
+	fw_sock = -1;
+	k_mutex_unlock(&fw_tx_lock);
+
+	atomic_clear(&fw_busy);
+}
+
+int fw_upload_ws_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data)
+{
+	if (!http_auth_bearer_ok(request_ctx)) {
+		LOG_WRN("Refusing firmware upload without a valid token");
+		return -EACCES;
+	}
+
+	if (!atomic_cas(&fw_busy, 0, 1)) {
+		LOG_ERR("Firmware upload already in progress");
+		return -EBUSY;
+	}
+
+	if (fw_rx_started) {
+		(void)k_thread_join(&fw_rx_thread, K_FOREVER);
+	}
+
+	fw_sock = ws_socket;
+	atomic_set(&fw_status, 0);
+
+	k_thread_create(&fw_rx_thread, fw_rx_stack, K_THREAD_STACK_SIZEOF(fw_rx_stack),
+			fw_rx_handler, NULL, NULL, NULL, FW_THREAD_PRIORITY, 0, K_NO_WAIT);
+	fw_rx_started = true;
+
+	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+		k_thread_name_set(&fw_rx_thread, "fw_rx");
+	}
+
+	LOG_INF("Accepted websocket connection for firmware upload");
+
+	return 0;
+}
+#endif /* CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE */
+
+/* Client whose POST holds fw_busy, and the outcome of its upload so far */
+static const struct http_client_ctx *fw_post_client;
+static int fw_post_err;
+
+static int fw_upload_post_handler(struct http_client_ctx *client, enum http_data_status status,
+				  const struct http_request_ctx *request_ctx,
+				  struct http_response_ctx *response_ctx, void *user_data)
+{
+	static char result[64];
+	int ret;
+
+	if (status == HTTP_SERVER_DATA_ABORTED) {
+		if (fw_post_client == client) {
+			fw_post_client = NULL;
+			atomic_clear(&fw_busy);
+		}
+		return 0;
+	}
+
+	/* Chunks of another client must not end up in the image */
+	if (fw_post_client != client) {
+		/* The body of a refused request is read and discarded */
+		if (!http_auth_bearer_ok(request_ctx)) {
+			if (status == HTTP_SERVER_DATA_FINAL) {
+				LOG_WRN("Refusing firmware upload without a valid token");
+				response_ctx->status = HTTP_401_UNAUTHORIZED;
+				response_ctx->headers = &http_auth_challenge_header;
+				response_ctx->header_count = 1;
+				response_ctx->final_chunk = true;
+			}
+			return 0;
+		}
+
+		if (!atomic_cas(&fw_busy, 0, 1)) {
+			LOG_ERR("Firmware upload already in progress");
+			return -EBUSY;
+		}
+
+		fw_post_client = client;
+		fw_post_err = fw_begin(client->content_len);
+	}
+
+	if (fw_post_err == 0 && request_ctx->data_len > 0) {
+		fw_post_err = flash_img_buffered_write(&fw_img, request_ctx->data,
+						       request_ctx->data_len, false);
+	}
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	if (fw_post_err == 0) {
+		fw_post_err = fw_finish();
+	}
+
+	ret = snprintf(result, sizeof(result), "{\"status\":%d,\"written\":%zu,\"ms\":%lld}",
+		       fw_post_err, flash_img_bytes_written(&fw_img), k_uptime_get() - fw_start);
+
+	response_ctx->status = fw_post_err == 0 ? HTTP_200_OK : HTTP_500_INTERNAL_SERVER_ERROR;
+	response_ctx->body = (const uint8_t *)result;
+	response_ctx->body_len = MIN(ret, sizeof(result) - 1);
+	response_ctx->final_chunk = true;
+
+	fw_post_client = NULL;
+	atomic_clear(&fw_busy);
+
+	return 0;
+}
+
+struct http_resource_detail_dynamic fw_upload_post_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_DYNAMIC,
+			.bitmask_of_supported_http_methods = BIT(HTTP_POST),
+		},
+	.cb = fw_upload_post_handler,
+	.user_data = NULL,
+};
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_FW_UPLOAD_H_
+#define APP_FW_UPLOAD_H_
+
+#include <zephyr/net/http/server.h>
+
+/*
+ * Websocket firmware upload protocol. All messages are binary, start with a
+ * one byte type and carry little endian fields.
+ *
+ * Client to server:
+ *  'S' u32 size      start an upload of size bytes
+ *  'D' u32 seq data  chunk number seq, at most fw_upload chunk size bytes
+ *  'E'               all chunks sent
+ *
+ * Server to client:
+ *  'R' u16 window u16 chunk   ready, at most window chunks may be in flight
+ *  'A' u32 seq u32 written    chunk seq and all before it are in flash
+ *  'F' i32 status u32 written u32 ms   upload finished (status 0) or failed
+ */
+#define FW_MSG_START 'S'
+#define FW_MSG_DATA  'D'
+#define FW_MSG_END   'E'
+#define FW_MSG_READY 'R'
+#define FW_MSG_ACK   'A'
+#define FW_MSG_DONE  'F'
+
+/**
+ * @brief Setup websocket for uploading a firmware image to slot1
+ *
+ * @param ws_socket Socket file descriptor associated with websocket
+ * @param request_ctx Request context associated with websocket HTTP upgrade request
+ * @param user_data User data pointer
+ *
+ * @return 0 on success
+ */
+int fw_upload_ws_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data);
+
+/** @brief Dynamic resource detail accepting a firmware image as POST body */
+extern struct http_resource_detail_dynamic fw_upload_post_resource_detail;
+
+#endif /* APP_FW_UPLOAD_H_ */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/http/service.h>
+
+#include "http_auth.h"
+
+HTTP_SERVER_REGISTER_HEADER_CAPTURE(http_auth_authorization, "Authorization");
+
+#define HTTP_AUTH_BEARER "Bearer "
+
+const struct http_header http_auth_challenge_header = {
+	.name = "WWW-Authenticate",
+	.value = "Bearer",
+};
+
+const char *http_auth_header(const struct http_request_ctx *request_ctx, const char *name)
+{
+	for (size_t i = 0; i < request_ctx->header_count; i++) {
+		if (strcasecmp(request_ctx->headers[i].name, name) == 0) {
+			return request_ctx->headers[i].value;
+		}
+	}
+
+	return NULL;
+}
+
+bool http_auth_bearer_ok(const struct http_request_ctx *request_ctx)
+{
+	const char *token = CONFIG_NET_SAMPLE_AUTH_TOKEN;
+	const char *value = http_auth_header(request_ctx, "Authorization");
+	size_t len = strlen(token);
+	uint8_t diff = 0;
+
+	if (len == 0 || value == NULL || strncmp(value, HTTP_AUTH_BEARER,
+						 sizeof(HTTP_AUTH_BEARER) - 1) != 0) {
+		return false;
+	}
+
+	value += sizeof(HTTP_AUTH_BEARER) - 1;
+	if (strlen(value) != len) {
+		return false;
+	}
+
+	/* Same time whatever the first differing byte */
+	for (size_t i = 0; i < len; i++) {
+		diff |= value[i] ^ token[i];
+	}
+
+	return diff == 0;
+}
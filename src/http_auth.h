@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_HTTP_AUTH_H_
+#define APP_HTTP_AUTH_H_
+
+#include <stdbool.h>
+
+#include <zephyr/net/http/server.h>
+
+/*
+ * Resources that expose or destroy device internals, such as flash
+ * contents and core dumps, require "Authorization: Bearer" with
+ * CONFIG_NET_SAMPLE_AUTH_TOKEN. The header is captured by the server for
+ * every request.
+ */
+
+/** Header of a 401 response, to give with http_auth_bearer_ok() failures */
+extern const struct http_header http_auth_challenge_header;
+
+/**
+ * @brief Find a captured request header
+ *
+ * @param request_ctx Request context passed to the resource callback
+ * @param name Header name, compared without case
+ *
+ * @return Header value, NULL if the request had no such header or it was
+ *         not captured
+ */
+const char *http_auth_header(const struct http_request_ctx *request_ctx, const char *name);
+
+/**
+ * @brief Check the bearer token of a request
+ *
+ * Without a token configured every request is refused.
+ *
+ * @param request_ctx Request context passed to the resource callback
+ *
+ * @return true if the request carries the configured token
+ */
+bool http_auth_bearer_ok(const struct http_request_ctx *request_ctx);
+
+#endif /* APP_HTTP_AUTH_H_ */
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/atomic.h>
+
+#include "http_stats.h"
+#include "route.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+/* One entry per client context of the http and https services */
+#define HTTP_STATS_MAX_CONN (2 * CONFIG_HTTP_SERVER_MAX_CLIENTS)
+
+/* Headers a handler may give with the last response of a connection */
+#define HTTP_STATS_MAX_HEADERS 4
+
+struct http_conn {
+	const struct http_client_ctx *client;
+	int fd;
+	uint16_t peer_port;
+	uint32_t requests;
+	/* Headers of the last response plus Connection: close, sent before
+	 * the server calls back again for this client
+	 */
+	struct http_header headers[HTTP_STATS_MAX_HEADERS + 1];
+};
+
+static struct http_conn conns[HTTP_STATS_MAX_CONN];
+static size_t next_victim;
+static struct k_spinlock conns_lock;
+
+static atomic_t stat_connections;
+static atomic_t stat_requests;
+static atomic_t stat_reused;
+static atomic_t stat_closed_at_limit;
+static atomic_t stat_dropped_at_limit;
+
+static const struct http_header connection_close_header[] = {
+	{.name = "Connection", .value = "close"},
+};
+
+static uint16_t peer_port_get(int fd)
+{
+	struct sockaddr addr;
+	socklen_t len = sizeof(addr);
+
+	if (zsock_getpeername(fd, &addr, &len) < 0) {
+		return 0;
+	}
+
+	if (addr.sa_family == AF_INET6) {
+		return ntohs(net_sin6(&addr)->sin6_port);
+	}
+
+	return ntohs(net_sin(&addr)->sin_port);
+}
+
+/* A client context is reused by the server for the next accepted socket,
+ * and so may be its descriptor number, so the peer port is what tells two
+ * connections apart. Called with conns_lock held.
+ */
+static struct http_conn *conn_get(const struct http_client_ctx *client, uint16_t port)
+{
+	struct http_conn *conn = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(conns); i++) {
+		if (conns[i].client == client) {
+			conn = &conns[i];
+			break;
+		}
+	}
+
+	if (conn == NULL) {
+		conn = &conns[next_victim];
+		next_victim = (next_victim + 1) % ARRAY_SIZE(conns);
+	} else if (conn->fd == client->fd && conn->peer_port == port) {
+		return conn;
+	}
+
+	conn->client = client;
+	conn->fd = client->fd;
+	conn->peer_port = port;
+	conn->requests = 0;
+	atomic_inc(&stat_connections);
+
+	return conn;
+}
+
+static bool conn_over_limit(uint32_t requests)
+{
+	return CONFIG_NET_SAMPLE_HTTP_MAX_REQUESTS_PER_CONN > 0 &&
+	       requests > CONFIG_NET_SAMPLE_HTTP_MAX_REQUESTS_PER_CONN;
+}
+
+static int conn_drop(struct http_client_ctx *client, uint32_t requests)
+{
+	/* The client ignored the Connection: close of the last response,
+	 * failing the callback makes the server drop the connection
+	 */
+	LOG_WRN("Dropping connection %d after %u requests", client->fd, requests - 1);
+	atomic_inc(&stat_dropped_at_limit);
+
+	return -ECONNRESET;
+}
+
+/* Add Connection: close to the headers the handler set, if any */
+static void conn_close_header_add(struct http_conn *conn, struct http_response_ctx *response_ctx)
+{
+	size_t count = response_ctx->header_count;
+
+	if (count == 0) {
+		response_ctx->headers = connection_close_header;
+		response_ctx->header_count = ARRAY_SIZE(connection_close_header);
+		return;
+	}
+
+	if (count > HTTP_STATS_MAX_HEADERS) {
+		LOG_ERR("Too many headers (%zu) to add Connection: close", count);
+		return;
+	}
+
+	memcpy(conn->headers, response_ctx->headers, count * sizeof(conn->headers[0]));
+	conn->headers[count] = connection_close_header[0];
+	response_ctx->headers = conn->headers;
+	response_ctx->header_count = count + 1;
+}
+
+int http_stats_request_check(struct http_client_ctx *client)
+{
+	uint16_t port;
+	k_spinlock_key_t key;
+	uint32_t requests;
+
+	if (CONFIG_NET_SAMPLE_HTTP_MAX_REQUESTS_PER_CONN == 0 || client->current_stream != NULL) {
+		return 0;
+	}
+
+	port = peer_port_get(client->fd);
+
+	key = k_spin_lock(&conns_lock);
+	requests = conn_get(client, port)->requests + 1;
+	k_spin_unlock(&conns_lock, key);
+
+	if (conn_over_limit(requests)) {
+		return conn_drop(client, requests);
+	}
+
+	return 0;
+}
+
+int http_stats_request_done(struct http_client_ctx *client,
+			    struct http_response_ctx *response_ctx)
+{
+	uint16_t port;
+	k_spinlock_key_t key;
+	uint32_t requests;
+	struct http_conn *conn;
+
+	/* HTTP/2 multiplexes streams on one connection and forbids the
+	 * Connection header, only HTTP/1.x requests are accounted
+	 */
+	if (client->current_stream != NULL) {
+		return 0;
+	}
+
+	port = peer_port_get(client->fd);
+
+	key = k_spin_lock(&conns_lock);
+	conn = conn_get(client, port);
+	requests = ++conn->requests;
+	k_spin_unlock(&conns_lock, key);
+
+	if (conn_over_limit(requests)) {
+		return conn_drop(client, requests);
+	}
+
+	atomic_inc(&stat_requests);
+	if (requests > 1) {
+		atomic_inc(&stat_reused);
+	}
+
+	if (CONFIG_NET_SAMPLE_HTTP_MAX_REQUESTS_PER_CONN > 0 &&
+	    requests == CONFIG_NET_SAMPLE_HTTP_MAX_REQUESTS_PER_CONN) {
+		LOG_DBG("Closing connection %d after %u requests", client->fd, requests);
+		conn_close_header_add(conn, response_ctx);
+		atomic_inc(&stat_closed_at_limit);
+	}
+
+	return 0;
+}
+
+int http_stats_json(char *buf, size_t maxlen)
+{
+	int ret;
+	uint32_t requests = atomic_get(&stat_requests);
+	uint32_t reused = atomic_get(&stat_reused);
+
+	ret = snprintf(buf, maxlen,
+		       "{"
+		       "\"connections\":%u,"
+		       "\"requests\":%u,"
+		       "\"reused\":%u,"
+		       "\"reuse_permille\":%u,"
+		       "\"closed_at_limit\":%u,"
+		       "\"dropped_at_limit\":%u"
+		       "}",
+		       (uint32_t)atomic_get(&stat_connections), requests, reused,
+		       requests ? (uint32_t)((uint64_t)reused * 1000U / requests) : 0U,
+		       (uint32_t)atomic_get(&stat_closed_at_limit),
+		       (uint32_t)atomic_get(&stat_dropped_at_limit));
+	if (ret >= maxlen) {
+		return -ENOSPC;
+	}
+
+	return ret;
+}
+
+static int http_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+			      const struct http_request_ctx *request_ctx,
+			      struct http_response_ctx *response_ctx,
+			      const struct route_params *params)
+{
+	static char json_buf[160];
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = http_stats_json(json_buf, sizeof(json_buf));
+	if (ret < 0) {
+		return ret;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(http_stats_route, "/stats/http", BIT(HTTP_GET), http_stats_handler);
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_HTTP_STATS_H_
+#define APP_HTTP_STATS_H_
+
+#include <stddef.h>
+
+#include <zephyr/net/http/server.h>
+
+/**
+ * @brief Check that a connection may carry one more request
+ *
+ * Meant for the first callback of a request, before the handler acts on
+ * it. Nothing is accounted.
+ *
+ * @param client HTTP client context the request was received on
+ *
+ * @return 0 if the request may be handled, -ECONNRESET if the client sent
+ *         it after being told to close, which the callback should return
+ *         so that the server drops the connection
+ */
+int http_stats_request_check(struct http_client_ctx *client);
+
+/**
+ * @brief Account a request on a persistent HTTP/1.x connection
+ *
+ * Must be called once per request, before its first response chunk is
+ * returned to the server and after the handler set its headers. Once the
+ * connection reaches CONFIG_NET_SAMPLE_HTTP_MAX_REQUESTS_PER_CONN requests,
+ * a "Connection: close" header is appended to the response headers so the
+ * client opens a fresh connection for the next request. HTTP/2 streams
+ * are not accounted.
+ *
+ * @param client HTTP client context the request was received on
+ * @param response_ctx Response context of the request
+ *
+ * @return 0 on success, -ECONNRESET if the client sent another request
+ *         after being told to close, which the callback should return so
+ *         that the server drops the connection
+ */
+int http_stats_request_done(struct http_client_ctx *client,
+			    struct http_response_ctx *response_ctx);
+
+/**
+ * @brief Format the connection reuse counters as JSON
+ *
+ * @param buf Output buffer
+ * @param maxlen Size of the output buffer
+ *
+ * @return Length of the JSON string on success, negative errno otherwise
+ */
+int http_stats_json(char *buf, size_t maxlen);
+
+#endif /* APP_HTTP_STATS_H_ */
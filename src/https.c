@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/tls_credentials.h>
+
+#include "https.h"
+#include "startup.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+static const unsigned char server_certificate[] = {
+#include "server_cert.der.inc"
+};
+
+static const unsigned char private_key[] = {
+#include "server_privkey.der.inc"
+};
+
+int https_socket_create(const struct http_service_desc *svc, int af, int proto)
+{
+	int sock;
+
+	ARG_UNUSED(svc);
+
+	sock = zsock_socket(af, SOCK_STREAM, proto);
+	if (sock < 0) {
+		return -errno;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_SAMPLE_HTTPS_SESSION_CACHE)) {
+		int cache = TLS_SESSION_CACHE_ENABLED;
+
+		/* Lets returning clients resume with an abbreviated handshake,
+		 * skipping the ECDHE/ECDSA operations of a full one.
+		 */
+		if (zsock_setsockopt(sock, SOL_TLS, TLS_SESSION_CACHE, &cache, sizeof(cache)) < 0) {
+			LOG_WRN("Failed to enable TLS session cache, err %d", errno);
+		}
+	}
+
+	return sock;
+}
+
+static int https_credentials_init(void)
+{
+	int ret;
+
+	ret = tls_credential_add(HTTPS_SERVER_CERTIFICATE_TAG, TLS_CREDENTIAL_SERVER_CERTIFICATE,
+				 server_certificate, sizeof(server_certificate));
+	if (ret < 0) {
+		LOG_ERR("Failed to register public certificate, err %d", ret);
+		return ret;
+	}
+
+	ret = tls_credential_add(HTTPS_SERVER_CERTIFICATE_TAG, TLS_CREDENTIAL_PRIVATE_KEY,
+				 private_key, sizeof(private_key));
+	if (ret < 0) {
+		LOG_ERR("Failed to register private key, err %d", ret);
+		return ret;
+	}
+
+	return 0;
+}
+STARTUP_TASK_DEFINE(https_credentials, STARTUP_HTTPS_CREDENTIALS, 0, https_credentials_init);
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_HTTPS_H_
+#define APP_HTTPS_H_
+
+#include <zephyr/net/http/service.h>
+#include <zephyr/net/tls_credentials.h>
+
+/** Credential tag of the server certificate and private key */
+#define HTTPS_SERVER_CERTIFICATE_TAG 1
+
+/**
+ * @brief Create the listening socket of the HTTPS service
+ *
+ * Used as socket_create hook of the HTTPS service configuration so the TLS
+ * session cache can be enabled before the server applies its own options.
+ * Accepted sockets inherit the option from the listening socket.
+ *
+ * @param svc HTTPS service descriptor
+ * @param af Address family
+ * @param proto TLS protocol
+ *
+ * @return Socket file descriptor on success, negative errno otherwise
+ */
+int https_socket_create(const struct http_service_desc *svc, int af, int proto);
+
+#endif /* APP_HTTPS_H_ */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_LED_COMMAND_H_
+#define APP_LED_COMMAND_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Body of a POST to /led, e.g. {"led_num":1,"led_state":true} */
+struct led_command {
+	int led_num;
+	bool led_state;
+};
+
+/**
+ * @brief Parse the JSON body of a POST to /led
+ *
+ * @param buf JSON text, modified in place by the parser
+ * @param len Length of the JSON text
+ * @param cmd Parsed command
+ *
+ * @return 0 on success, -EINVAL if a field is missing or malformed
+ */
+int led_command_parse(uint8_t *buf, size_t len, struct led_command *cmd);
+
+#endif /* APP_LED_COMMAND_H_ */
@@ -24,26 +24,40 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/storage/flash_map.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/dfu/mcuboot.h>
 
 #if CONFIG_USB_DEVICE_STACK_NEXT
 #include <sample_usbd.h>
 #endif
 
+#include "conn_state.h"
+#include "crash_dump.h"
+#include "fw_upload.h"
+#include "http_stats.h"
+#include "https.h"
+#include "led_command.h"
+#include "placement.h"
+#include "route.h"
+#include "startup.h"
 #include "ws.h"
+#include "ws_shell.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(net_http_server_sample, LOG_LEVEL_DBG);
 
-struct led_command {
-	int led_num;
-	bool led_state;
-};
-
 static const struct json_obj_descr led_command_descr[] = {
 	JSON_OBJ_DESCR_PRIM(struct led_command, led_num, JSON_TOK_NUMBER),
 	JSON_OBJ_DESCR_PRIM(struct led_command, led_state, JSON_TOK_TRUE),
 };
 
+struct led_state_command {
+	bool led_state;
+};
+
+static const struct json_obj_descr led_state_command_descr[] = {
+	JSON_OBJ_DESCR_PRIM(struct led_state_command, led_state, JSON_TOK_TRUE),
+};
+
 static const struct device *leds_dev = DEVICE_DT_GET_ANY(gpio_leds);
 
 static uint8_t index_html_gz[] = {
@@ -81,27 +95,43 @@ static int echo_handler(struct http_client_ctx *client, enum http_data_status st
 			struct http_response_ctx *response_ctx, void *user_data)
 {
 #define MAX_TEMP_PRINT_LEN 32
-	static char print_str[MAX_TEMP_PRINT_LEN];
+	char print_str[MAX_TEMP_PRINT_LEN];
 	enum http_method method = client->method;
-	static size_t processed;
+	struct conn_state *state;
+	int ret;
+
+	state = conn_state_get(client);
+	if (state == NULL) {
+		return -ENOMEM;
+	}
 
 	if (status == HTTP_SERVER_DATA_ABORTED) {
-		LOG_DBG("Transaction aborted after %zd bytes.", processed);
-		processed = 0;
+		LOG_DBG("Transaction aborted after %zd bytes.", state->received);
+		conn_state_release(client);
 		return 0;
 	}
 
 	__ASSERT_NO_MSG(buffer != NULL);
 
-	processed += request_ctx->data_len;
+	state->received += request_ctx->data_len;
 
 	snprintf(print_str, sizeof(print_str), "%s received (%zd bytes)", http_method_str(method),
 		 request_ctx->data_len);
 	LOG_HEXDUMP_DBG(request_ctx->data, request_ctx->data_len, print_str);
 
+	/* Headers go out with the first echoed chunk, account the request then */
+	if (!state->responding) {
+		state->responding = true;
+		ret = http_stats_request_done(client, response_ctx);
+		if (ret < 0) {
+			conn_state_release(client);
+			return ret;
+		}
+	}
+
 	if (status == HTTP_SERVER_DATA_FINAL) {
-		LOG_DBG("All data received (%zd bytes).", processed);
-		processed = 0;
+		LOG_DBG("All data received (%zd bytes).", state->received);
+		conn_state_release(client);
 	}
 
 	/* Echo data back to client */
@@ -143,6 +173,7 @@ static int uptime_handler(struct http_client_ctx *client, enum http_data_status
 		response_ctx->body = uptime_buf;
 		response_ctx->body_len = ret;
 		response_ctx->final_chunk = true;
+		return http_stats_request_done(client, response_ctx);
 	}
 
 	return 0;
@@ -157,59 +188,82 @@ static struct http_resource_detail_dynamic uptime_resource_detail = {
 	.user_data = NULL,
 };
 
-static void parse_led_post(uint8_t *buf, size_t len)
+static void led_set(int led_num, bool led_state)
+{
+	if (leds_dev != NULL) {
+		if (led_state) {
+			led_on(leds_dev, led_num);
+		} else {
+			led_off(leds_dev, led_num);
+		}
+	}
+}
+
+int led_command_parse(uint8_t *buf, size_t len, struct led_command *cmd)
 {
-	int ret;
-	struct led_command cmd;
 	const int expected_return_code = BIT_MASK(ARRAY_SIZE(led_command_descr));
+	int ret;
 
-	ret = json_obj_parse(buf, len, led_command_descr, ARRAY_SIZE(led_command_descr), &cmd);
+	ret = json_obj_parse(buf, len, led_command_descr, ARRAY_SIZE(led_command_descr), cmd);
 	if (ret != expected_return_code) {
 		LOG_WRN("Failed to fully parse JSON payload, ret=%d", ret);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void parse_led_post(uint8_t *buf, size_t len)
+{
+	struct led_command cmd;
+
+	if (led_command_parse(buf, len, &cmd) < 0) {
 		return;
 	}
 
 	LOG_INF("POST request setting LED %d to state %d", cmd.led_num, cmd.led_state);
 
-	if (leds_dev != NULL) {
-		if (cmd.led_state) {
-			//boot_request_upgrade(0);
-			led_on(leds_dev, cmd.led_num);
-		} else {
-			led_off(leds_dev, cmd.led_num);
-		}
-	}
+	led_set(cmd.led_num, cmd.led_state);
 }
 
 static int led_handler(struct http_client_ctx *client, enum http_data_status status,
 		       const struct http_request_ctx *request_ctx,
 		       struct http_response_ctx *response_ctx, void *user_data)
 {
-	static uint8_t post_payload_buf[32];
-	static size_t cursor;
+	struct conn_state *state;
+	int ret;
 
 	LOG_DBG("LED handler status %d, size %zu", status, request_ctx->data_len);
 
-	if (status == HTTP_SERVER_DATA_ABORTED) {
-		cursor = 0;
-		return 0;
+	state = conn_state_get(client);
+	if (state == NULL) {
+		return -ENOMEM;
 	}
 
-	if (request_ctx->data_len + cursor > sizeof(post_payload_buf)) {
-		cursor = 0;
-		return -ENOMEM;
+	if (status == HTTP_SERVER_DATA_ABORTED) {
+		conn_state_release(client);
+		return 0;
 	}
 
 	/* Copy payload to our buffer. Note that even for a small payload, it may arrive split into
 	 * chunks (e.g. if the header size was such that the whole HTTP request exceeds the size of
 	 * the client buffer).
 	 */
-	memcpy(post_payload_buf + cursor, request_ctx->data, request_ctx->data_len);
-	cursor += request_ctx->data_len;
+	if (conn_state_append(state, request_ctx->data, request_ctx->data_len) < 0) {
+		conn_state_release(client);
+		return -ENOMEM;
+	}
 
 	if (status == HTTP_SERVER_DATA_FINAL) {
-		parse_led_post(post_payload_buf, cursor);
-		cursor = 0;
+		conn_state_release(client);
+
+		ret = http_stats_request_check(client);
+		if (ret < 0) {
+			return ret;
+		}
+
+		parse_led_post(state->body, state->body_len);
+		return http_stats_request_done(client, response_ctx);
 	}
 
 	return 0;
@@ -224,8 +278,63 @@ static struct http_resource_detail_dynamic led_resource_detail = {
 	.user_data = NULL,
 };
 
+static int led_route_handler(struct http_client_ctx *client, enum http_data_status status,
+			     const struct http_request_ctx *request_ctx,
+			     struct http_response_ctx *response_ctx,
+			     const struct route_params *params)
+{
+	struct led_state_command cmd;
+	struct conn_state *state;
+	uint32_t led_num;
+	int ret;
+
+	/* Owned and released by route_dispatch() */
+	state = conn_state_get(client);
+	if (state == NULL) {
+		return -ENOMEM;
+	}
+
+	if (status == HTTP_SERVER_DATA_ABORTED) {
+		return 0;
+	}
+
+	ret = conn_state_append(state, request_ctx->data, request_ctx->data_len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = route_param_to_uint(params, "n", &led_num);
+	if (ret < 0) {
+		LOG_WRN("Invalid LED number in %s", client->url_buffer);
+		response_ctx->status = HTTP_400_BAD_REQUEST;
+		goto out;
+	}
+
+	ret = json_obj_parse(state->body, state->body_len, led_state_command_descr,
+			     ARRAY_SIZE(led_state_command_descr), &cmd);
+	if (ret != BIT_MASK(ARRAY_SIZE(led_state_command_descr))) {
+		LOG_WRN("Failed to fully parse JSON payload, ret=%d", ret);
+		response_ctx->status = HTTP_400_BAD_REQUEST;
+		goto out;
+	}
+
+	LOG_INF("POST request setting LED %u to state %d", led_num, cmd.led_state);
+	led_set(led_num, cmd.led_state);
+
+out:
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(led_route, "/led/{n}", BIT(HTTP_POST), led_route_handler);
+
 #if defined(CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE)
-static uint8_t ws_echo_buffer[1024];
+static uint8_t APP_CCM_NOINIT ws_echo_buffer[1024];
 
 struct http_resource_detail_websocket ws_echo_resource_detail = {
 	.common = {
@@ -240,6 +349,23 @@ struct http_resource_detail_websocket ws_echo_resource_detail = {
 	.user_data = NULL, /* Fill this for any user specific data */
 };
 
+static uint8_t APP_CCM_NOINIT ws_echo_msg_buffer[1024];
+
+static const struct ws_resource_config ws_echo_msg_config = {
+	.message_mode = true,
+};
+
+struct http_resource_detail_websocket ws_echo_msg_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_echo_setup,
+	.data_buffer = ws_echo_msg_buffer,
+	.data_buffer_len = sizeof(ws_echo_msg_buffer),
+	.user_data = (void *)&ws_echo_msg_config,
+};
+
 static uint8_t ws_netstats_buffer[128];
 
 struct http_resource_detail_websocket ws_netstats_resource_detail = {
@@ -253,6 +379,130 @@ struct http_resource_detail_websocket ws_netstats_resource_detail = {
 	.user_data = NULL,
 };
 
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+static uint8_t ws_netstats_deflate_buffer[128];
+
+static const struct ws_resource_config ws_netstats_deflate_config = {
+	.deflate = true,
+};
+
+struct http_resource_detail_websocket ws_netstats_deflate_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_netstats_setup,
+	.data_buffer = ws_netstats_deflate_buffer,
+	.data_buffer_len = sizeof(ws_netstats_deflate_buffer),
+	.user_data = (void *)&ws_netstats_deflate_config,
+};
+#endif /* CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE */
+
+#if defined(CONFIG_NET_SAMPLE_SENSOR_STREAM)
+static uint8_t ws_sensor_buffer[128];
+
+static const struct ws_resource_config ws_sensor_config = {
+	.topics = WS_TOPIC_SENSOR,
+};
+
+struct http_resource_detail_websocket ws_sensor_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_netstats_setup,
+	.data_buffer = ws_sensor_buffer,
+	.data_buffer_len = sizeof(ws_sensor_buffer),
+	.user_data = (void *)&ws_sensor_config,
+};
+#endif /* CONFIG_NET_SAMPLE_SENSOR_STREAM */
+
+#if defined(CONFIG_NET_SAMPLE_BUTTON_PUSH)
+static uint8_t ws_button_buffer[128];
+
+static const struct ws_resource_config ws_button_config = {
+	.topics = WS_TOPIC_BUTTON,
+};
+
+struct http_resource_detail_websocket ws_button_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_netstats_setup,
+	.data_buffer = ws_button_buffer,
+	.data_buffer_len = sizeof(ws_button_buffer),
+	.user_data = (void *)&ws_button_config,
+};
+#endif /* CONFIG_NET_SAMPLE_BUTTON_PUSH */
+
+#if defined(CONFIG_NET_SAMPLE_ADC_STREAM)
+static uint8_t ws_adc_buffer[128];
+
+static const struct ws_resource_config ws_adc_config = {
+	.topics = WS_TOPIC_ADC,
+};
+
+struct http_resource_detail_websocket ws_adc_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_netstats_setup,
+	.data_buffer = ws_adc_buffer,
+	.data_buffer_len = sizeof(ws_adc_buffer),
+	.user_data = (void *)&ws_adc_config,
+};
+#endif /* CONFIG_NET_SAMPLE_ADC_STREAM */
+
+#if defined(CONFIG_NET_SAMPLE_SERIAL_BRIDGE)
+static uint8_t ws_serial_buffer[128];
+
+static const struct ws_resource_config ws_serial_config = {
+	.topics = WS_TOPIC_SERIAL,
+};
+
+struct http_resource_detail_websocket ws_serial_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_netstats_setup,
+	.data_buffer = ws_serial_buffer,
+	.data_buffer_len = sizeof(ws_serial_buffer),
+	.user_data = (void *)&ws_serial_config,
+};
+#endif /* CONFIG_NET_SAMPLE_SERIAL_BRIDGE */
+
+#if defined(CONFIG_NET_SAMPLE_WS_SHELL)
+static uint8_t ws_shell_buffer[128];
+
+struct http_resource_detail_websocket ws_shell_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = ws_shell_setup,
+	.data_buffer = ws_shell_buffer,
+	.data_buffer_len = sizeof(ws_shell_buffer),
+	.user_data = NULL,
+};
+#endif /* CONFIG_NET_SAMPLE_WS_SHELL */
+
+#if defined(CONFIG_NET_SAMPLE_FW_UPLOAD)
+static uint8_t fw_upload_ws_buffer[128];
+
+struct http_resource_detail_websocket fw_upload_ws_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_WEBSOCKET,
+			.bitmask_of_supported_http_methods = BIT(HTTP_GET),
+		},
+	.cb = fw_upload_ws_setup,
+	.data_buffer = fw_upload_ws_buffer,
+	.data_buffer_len = sizeof(fw_upload_ws_buffer),
+	.user_data = NULL,
+};
+#endif /* CONFIG_NET_SAMPLE_FW_UPLOAD */
 #endif /* CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE */
 
 #if defined(CONFIG_NET_SAMPLE_HTTP_SERVICE)
@@ -272,16 +522,188 @@ HTTP_RESOURCE_DEFINE(uptime_resource, test_http_service, "/uptime", &uptime_reso
 
 HTTP_RESOURCE_DEFINE(led_resource, test_http_service, "/led", &led_resource_detail);
 
+/* Parameterised routes, see ROUTE_DEFINE() */
+HTTP_RESOURCE_DEFINE(led_route_resource, test_http_service, "/led/*", &route_resource_detail);
+
+HTTP_RESOURCE_DEFINE(stats_route_resource, test_http_service, "/stats/*", &route_resource_detail);
+
+#if defined(CONFIG_NET_SAMPLE_SERIAL_BRIDGE)
+HTTP_RESOURCE_DEFINE(serial_route_resource, test_http_service, "/serial/*",
+		     &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SERIAL_BRIDGE */
+
+#if defined(CONFIG_NET_SAMPLE_FLASH_READOUT)
+HTTP_RESOURCE_DEFINE(flash_route_resource, test_http_service, "/flash/*", &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FLASH_READOUT */
+
+#if defined(CONFIG_NET_SAMPLE_FW_SLOTS)
+HTTP_RESOURCE_DEFINE(fw_route_resource, test_http_service, "/fw/*", &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FW_SLOTS */
+
+#if defined(CONFIG_NET_SAMPLE_SELF_BENCH)
+HTTP_RESOURCE_DEFINE(bench_route_resource, test_http_service, "/bench", &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SELF_BENCH */
+
 #if defined(CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE)
 HTTP_RESOURCE_DEFINE(ws_echo_resource, test_http_service, "/ws_echo", &ws_echo_resource_detail);
 
+HTTP_RESOURCE_DEFINE(ws_echo_msg_resource, test_http_service, "/ws_echo_msg",
+		     &ws_echo_msg_resource_detail);
+
 HTTP_RESOURCE_DEFINE(ws_netstats_resource, test_http_service, "/", &ws_netstats_resource_detail);
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+HTTP_RESOURCE_DEFINE(ws_netstats_deflate_resource, test_http_service, "/netstats.deflate",
+		     &ws_netstats_deflate_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE */
+
+#if defined(CONFIG_NET_SAMPLE_SENSOR_STREAM)
+HTTP_RESOURCE_DEFINE(ws_sensor_resource, test_http_service, "/sensor", &ws_sensor_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SENSOR_STREAM */
+
+#if defined(CONFIG_NET_SAMPLE_BUTTON_PUSH)
+HTTP_RESOURCE_DEFINE(ws_button_resource, test_http_service, "/button", &ws_button_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_BUTTON_PUSH */
+
+#if defined(CONFIG_NET_SAMPLE_ADC_STREAM)
+HTTP_RESOURCE_DEFINE(ws_adc_resource, test_http_service, "/adc", &ws_adc_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_ADC_STREAM */
+
+#if defined(CONFIG_NET_SAMPLE_SERIAL_BRIDGE)
+HTTP_RESOURCE_DEFINE(ws_serial_resource, test_http_service, "/ws_serial",
+		     &ws_serial_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SERIAL_BRIDGE */
+
+#if defined(CONFIG_NET_SAMPLE_FW_UPLOAD)
+HTTP_RESOURCE_DEFINE(fw_upload_ws_resource, test_http_service, "/upload_ws",
+		     &fw_upload_ws_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FW_UPLOAD */
 #endif /* CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE */
+
+#if defined(CONFIG_NET_SAMPLE_FW_UPLOAD)
+HTTP_RESOURCE_DEFINE(fw_upload_post_resource, test_http_service, "/upload",
+		     &fw_upload_post_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FW_UPLOAD */
+
+#if defined(CONFIG_NET_SAMPLE_CRASH_DUMP)
+HTTP_RESOURCE_DEFINE(crash_dump_resource, test_http_service, "/coredump",
+		     &crash_dump_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_CRASH_DUMP */
 #endif /* CONFIG_NET_SAMPLE_HTTP_SERVICE */
 
+#if defined(CONFIG_NET_SAMPLE_HTTPS_SERVICE)
+static const sec_tag_t sec_tag_list_verify_none[] = {
+	HTTPS_SERVER_CERTIFICATE_TAG,
+};
+
+static const struct http_service_config test_https_service_config = {
+	.socket_create = https_socket_create,
+};
+
+static uint16_t test_https_service_port = CONFIG_NET_SAMPLE_HTTPS_SERVER_SERVICE_PORT;
+HTTPS_SERVICE_DEFINE(test_https_service, NULL, &test_https_service_port,
+		     CONFIG_HTTP_SERVER_MAX_CLIENTS, 10, NULL, NULL, sec_tag_list_verify_none,
+		     sizeof(sec_tag_list_verify_none), &test_https_service_config);
+
+HTTP_RESOURCE_DEFINE(index_html_gz_resource_https, test_https_service, "/",
+		     &index_html_gz_resource_detail);
+
+HTTP_RESOURCE_DEFINE(main_js_gz_resource_https, test_https_service, "/main.js",
+		     &main_js_gz_resource_detail);
+
+HTTP_RESOURCE_DEFINE(echo_resource_https, test_https_service, "/dynamic",
+		     &echo_resource_detail);
+
+HTTP_RESOURCE_DEFINE(uptime_resource_https, test_https_service, "/uptime",
+		     &uptime_resource_detail);
+
+HTTP_RESOURCE_DEFINE(led_resource_https, test_https_service, "/led", &led_resource_detail);
+
+HTTP_RESOURCE_DEFINE(led_route_resource_https, test_https_service, "/led/*",
+		     &route_resource_detail);
+
+HTTP_RESOURCE_DEFINE(stats_route_resource_https, test_https_service, "/stats/*",
+		     &route_resource_detail);
+
+#if defined(CONFIG_NET_SAMPLE_SERIAL_BRIDGE)
+HTTP_RESOURCE_DEFINE(serial_route_resource_https, test_https_service, "/serial/*",
+		     &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SERIAL_BRIDGE */
+
+#if defined(CONFIG_NET_SAMPLE_FLASH_READOUT)
+HTTP_RESOURCE_DEFINE(flash_route_resource_https, test_https_service, "/flash/*",
+		     &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FLASH_READOUT */
+
+#if defined(CONFIG_NET_SAMPLE_FW_SLOTS)
+HTTP_RESOURCE_DEFINE(fw_route_resource_https, test_https_service, "/fw/*",
+		     &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FW_SLOTS */
+
+#if defined(CONFIG_NET_SAMPLE_SELF_BENCH)
+HTTP_RESOURCE_DEFINE(bench_route_resource_https, test_https_service, "/bench",
+		     &route_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SELF_BENCH */
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE)
+HTTP_RESOURCE_DEFINE(ws_echo_resource_https, test_https_service, "/ws_echo",
+		     &ws_echo_resource_detail);
+
+HTTP_RESOURCE_DEFINE(ws_echo_msg_resource_https, test_https_service, "/ws_echo_msg",
+		     &ws_echo_msg_resource_detail);
+
+HTTP_RESOURCE_DEFINE(ws_netstats_resource_https, test_https_service, "/",
+		     &ws_netstats_resource_detail);
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+HTTP_RESOURCE_DEFINE(ws_netstats_deflate_resource_https, test_https_service,
+		     "/netstats.deflate", &ws_netstats_deflate_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE */
+
+#if defined(CONFIG_NET_SAMPLE_SENSOR_STREAM)
+HTTP_RESOURCE_DEFINE(ws_sensor_resource_https, test_https_service, "/sensor",
+		     &ws_sensor_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SENSOR_STREAM */
+
+#if defined(CONFIG_NET_SAMPLE_BUTTON_PUSH)
+HTTP_RESOURCE_DEFINE(ws_button_resource_https, test_https_service, "/button",
+		     &ws_button_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_BUTTON_PUSH */
+
+#if defined(CONFIG_NET_SAMPLE_ADC_STREAM)
+HTTP_RESOURCE_DEFINE(ws_adc_resource_https, test_https_service, "/adc", &ws_adc_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_ADC_STREAM */
+
+#if defined(CONFIG_NET_SAMPLE_SERIAL_BRIDGE)
+HTTP_RESOURCE_DEFINE(ws_serial_resource_https, test_https_service, "/ws_serial",
+		     &ws_serial_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_SERIAL_BRIDGE */
+
+#if defined(CONFIG_NET_SAMPLE_WS_SHELL)
+HTTP_RESOURCE_DEFINE(ws_shell_resource_https, test_https_service, "/shell",
+		     &ws_shell_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_WS_SHELL */
+
+#if defined(CONFIG_NET_SAMPLE_FW_UPLOAD)
+HTTP_RESOURCE_DEFINE(fw_upload_ws_resource_https, test_https_service, "/upload_ws",
+		     &fw_upload_ws_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FW_UPLOAD */
+#endif /* CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE */
+
+#if defined(CONFIG_NET_SAMPLE_FW_UPLOAD)
+HTTP_RESOURCE_DEFINE(fw_upload_post_resource_https, test_https_service, "/upload",
+		     &fw_upload_post_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_FW_UPLOAD */
+
+#if defined(CONFIG_NET_SAMPLE_CRASH_DUMP)
+HTTP_RESOURCE_DEFINE(crash_dump_resource_https, test_https_service, "/coredump",
+		     &crash_dump_resource_detail);
+#endif /* CONFIG_NET_SAMPLE_CRASH_DUMP */
+#endif /* CONFIG_NET_SAMPLE_HTTPS_SERVICE */
+
+#if defined(CONFIG_USB_DEVICE_STACK_NEXT)
 static int init_usb(void)
 {
-#if defined(CONFIG_USB_DEVICE_STACK_NEXT)
 	struct usbd_context *sample_usbd;
 	int err;
 
@@ -296,10 +718,11 @@ static int init_usb(void)
 	}
 
 	(void)net_config_init_app(NULL, "Initializing network");
-#endif /* CONFIG_USB_DEVICE_STACK_NEXT */
 
 	return 0;
 }
+STARTUP_TASK_DEFINE(usb, STARTUP_USB, 0, init_usb);
+#endif /* CONFIG_USB_DEVICE_STACK_NEXT */
 
 
 // #ifdef CONFIG_APP_LITTLEFS_STORAGE_FLASH
@@ -378,32 +801,24 @@ static int init_usb(void)
 // #endif /* CONFIG_APP_LITTLEFS_STORAGE_FLASH */
 
 
-int main(void)
+#if defined(CONFIG_MCUBOOT_IMG_MANAGER)
+static int boot_request(void)
 {
-	int rc;
-	LOG_DBG("STARTING");
-	boot_request_upgrade(0);
-	LOG_PRINTK("!!Sample program to r/w files on littlefs!!\n");
-//	init_usb();
-	// rc = littlefs_mount(mountpoint);
-	// if (rc < 0) {
-	// 	return 0;
-	// }
-
-	// void *storage;
-
-	// struct fs_dirent entry;
-    // LOG_DBG("STARTING");
-	// rc = settings_storage_get(&storage);
-	// if (rc) LOG_PRINTK("Can't fetch storage reference (err=%d)", rc);
+	return boot_request_upgrade(0);
+}
+STARTUP_TASK_DEFINE(boot_request, STARTUP_BOOT_REQUEST, 0, boot_request);
+#endif /* CONFIG_MCUBOOT_IMG_MANAGER */
 
-	// LOG_PRINTK("Null reference.");
+/* The listener comes up once the websocket threads can take connections
+ * and the TLS credentials are registered, whatever else is still going on.
+ */
+STARTUP_TASK_DEFINE(http_server, STARTUP_HTTP_SERVER,
+		    BIT(STARTUP_HTTPS_CREDENTIALS) | BIT(STARTUP_WS_PUSH) | BIT(STARTUP_WS_SHELL),
+		    http_server_start);
 
-	// rc = fs_stat((const char *)storage, &entry);
+int main(void)
+{
+	LOG_DBG("STARTING");
 
-	// if (rc) LOG_PRINTK("Can't find the file (err=%d)", rc);
-// settings_subsys_init();
-//boot_request_upgrade(false);
-	http_server_start();
-	return 0;
+	return startup_run();
 }
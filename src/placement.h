@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_PLACEMENT_H_
+#define APP_PLACEMENT_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/linker/section_tags.h>
+
+/*
+ * Memory placement of the hot paths, see NET_SAMPLE_CCM_PLACEMENT and
+ * NET_SAMPLE_HOT_CODE_IN_RAM.
+ *
+ * Core coupled memory is only on the CPU data bus: DMA cannot reach it and
+ * code cannot run from it. Only buffers the CPU alone touches, such as
+ * socket receive buffers and thread stacks, may be tagged APP_CCM_*.
+ *
+ * APP_CCM_STACK_* define kernel stacks in either case, size them with
+ * K_KERNEL_STACK_SIZEOF(). Zephyr has no public macro taking a section,
+ * the CCM variants go through the one behind K_KERNEL_STACK_DEFINE().
+ */
+
+#if defined(CONFIG_NET_SAMPLE_CCM_PLACEMENT)
+/* Zero initialised at boot */
+#define APP_CCM_BSS __ccm_bss_section
+/* Left as is at boot, for memory that is always written before use */
+#define APP_CCM_NOINIT __ccm_noinit_section
+
+#define APP_CCM_STACK_DEFINE(sym, size) \
+	Z_KERNEL_STACK_DEFINE_IN(sym, size, __ccm_noinit_section)
+#define APP_CCM_STACK_ARRAY_DEFINE(sym, nmemb, size) \
+	Z_KERNEL_STACK_ARRAY_DEFINE_IN(sym, nmemb, size, __ccm_noinit_section)
+#define APP_CCM_MEM_SLAB_DEFINE_STATIC(name, size, num, align) \
+	K_MEM_SLAB_DEFINE_IN_SECT_STATIC(name, __ccm_noinit_section, size, num, align)
+#else
+#define APP_CCM_BSS
+#define APP_CCM_NOINIT
+
+#define APP_CCM_STACK_DEFINE(sym, size) K_KERNEL_STACK_DEFINE(sym, size)
+#define APP_CCM_STACK_ARRAY_DEFINE(sym, nmemb, size) K_KERNEL_STACK_ARRAY_DEFINE(sym, nmemb, size)
+#define APP_CCM_MEM_SLAB_DEFINE_STATIC(name, size, num, align) \
+	K_MEM_SLAB_DEFINE_STATIC(name, size, num, align)
+#endif /* CONFIG_NET_SAMPLE_CCM_PLACEMENT */
+
+#if defined(CONFIG_NET_SAMPLE_HOT_CODE_IN_RAM)
+/* Copied to SRAM at boot and executed from there */
+#define APP_HOT_CODE __ramfunc
+#else
+#define APP_HOT_CODE
+#endif
+
+#endif /* APP_PLACEMENT_H_ */
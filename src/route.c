@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/http/service.h>
+#include <zephyr/sys/util.h>
+
+#include "conn_state.h"
+#include "http_stats.h"
+#include "route.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+static int route_add_param(struct route_params *params, const char *name, size_t name_len,
+			   const char *value, size_t value_len)
+{
+	struct route_param *param;
+
+	if (params->count >= ARRAY_SIZE(params->param)) {
+		return -ENOMEM;
+	}
+
+	param = &params->param[params->count++];
+	param->name = name;
+	param->name_len = name_len;
+	param->value = value;
+	param->value_len = value_len;
+
+	return 0;
+}
+
+int route_match(const char *pattern, const char *path, size_t path_len,
+		struct route_params *params)
+{
+	const char *p = pattern;
+	size_t pos = 0;
+	int ret;
+
+	params->count = 0;
+
+	while (*p != '\0') {
+		if (*p == '{') {
+			const char *name = p + 1;
+			const char *end = strchr(name, '}');
+			size_t start = pos;
+
+			if (end == NULL) {
+				LOG_ERR("Unterminated capture in route %s", pattern);
+				return -EINVAL;
+			}
+
+			while (pos < path_len && path[pos] != '/') {
+				pos++;
+			}
+
+			if (pos == start) {
+				return -ENOENT;
+			}
+
+			ret = route_add_param(params, name, end - name, &path[start], pos - start);
+			if (ret < 0) {
+				return ret;
+			}
+
+			p = end + 1;
+		} else if (*p == '*') {
+			/* Tail capture consumes the rest of the path, including slashes */
+			ret = route_add_param(params, p + 1, strlen(p + 1), &path[pos],
+					      path_len - pos);
+			if (ret < 0) {
+				return ret;
+			}
+
+			return params->count;
+		} else {
+			if (pos >= path_len || path[pos] != *p) {
+				return -ENOENT;
+			}
+
+			p++;
+			pos++;
+		}
+	}
+
+	return (pos == path_len) ? params->count : -ENOENT;
+}
+
+const struct route_param *route_param_get(const struct route_params *params, const char *name)
+{
+	size_t len = strlen(name);
+
+	for (size_t i = 0; i < params->count; i++) {
+		if (params->param[i].name_len == len &&
+		    strncmp(params->param[i].name, name, len) == 0) {
+			return &params->param[i];
+		}
+	}
+
+	return NULL;
+}
+
+int route_param_to_uint(const struct route_params *params, const char *name, uint32_t *out)
+{
+	const struct route_param *param = route_param_get(params, name);
+	uint32_t val = 0;
+
+	if (param == NULL) {
+		return -ENOENT;
+	}
+
+	if (param->value_len == 0 || param->value_len > sizeof(STRINGIFY(UINT32_MAX)) - 1) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < param->value_len; i++) {
+		char c = param->value[i];
+
+		if (c < '0' || c > '9') {
+			return -EINVAL;
+		}
+
+		if (val > (UINT32_MAX - (c - '0')) / 10) {
+			return -EINVAL;
+		}
+
+		val = val * 10 + (c - '0');
+	}
+
+	*out = val;
+
+	return 0;
+}
+
+static size_t route_path_len(const char *url)
+{
+	size_t len = 0;
+
+	while (url[len] != '\0' && url[len] != '?' && url[len] != '#') {
+		len++;
+	}
+
+	return len;
+}
+
+static const struct app_route *route_find(struct http_client_ctx *client,
+					  struct route_params *params)
+{
+	const char *path = (const char *)client->url_buffer;
+	size_t path_len = route_path_len(path);
+
+	STRUCT_SECTION_FOREACH(app_route, route) {
+		if (route_match(route->pattern, path, path_len, params) >= 0) {
+			return route;
+		}
+	}
+
+	return NULL;
+}
+
+static int route_dispatch(struct http_client_ctx *client, enum http_data_status status,
+			  const struct http_request_ctx *request_ctx,
+			  struct http_response_ctx *response_ctx, void *user_data)
+{
+	const struct app_route *route;
+	struct conn_state *state;
+	int ret;
+
+	state = conn_state_get(client);
+	if (state == NULL) {
+		return -ENOMEM;
+	}
+
+	/* The match result is kept for the whole request so that a chunked
+	 * request body is matched only once, on its first chunk. A request
+	 * past the connection limit is refused before any handler sees it.
+	 */
+	if (state->route == NULL) {
+		ret = http_stats_request_check(client);
+		if (ret < 0) {
+			conn_state_release(client);
+			return ret;
+		}
+
+		state->route = route_find(client, &state->params);
+	}
+
+	route = state->route;
+
+	if (route == NULL) {
+		if (status != HTTP_SERVER_DATA_MORE) {
+			conn_state_release(client);
+		}
+
+		if (status == HTTP_SERVER_DATA_ABORTED) {
+			return 0;
+		}
+
+		if (status == HTTP_SERVER_DATA_FINAL) {
+			response_ctx->status = HTTP_404_NOT_FOUND;
+			response_ctx->final_chunk = true;
+			return http_stats_request_done(client, response_ctx);
+		}
+
+		return 0;
+	}
+
+	if (!(route->methods & BIT(client->method))) {
+		if (status != HTTP_SERVER_DATA_MORE) {
+			conn_state_release(client);
+		}
+
+		if (status == HTTP_SERVER_DATA_FINAL) {
+			response_ctx->status = HTTP_405_METHOD_NOT_ALLOWED;
+			response_ctx->final_chunk = true;
+			return http_stats_request_done(client, response_ctx);
+		}
+
+		return 0;
+	}
+
+	ret = route->cb(client, status, request_ctx, response_ctx, &state->params);
+	if (status == HTTP_SERVER_DATA_FINAL && ret == 0 && !state->responding) {
+		state->responding = true;
+		ret = http_stats_request_done(client, response_ctx);
+	}
+
+	/* A streamed response calls back with HTTP_SERVER_DATA_FINAL until
+	 * its last chunk, the state lives on until then
+	 */
+	if (status == HTTP_SERVER_DATA_ABORTED || ret < 0 ||
+	    (status == HTTP_SERVER_DATA_FINAL && response_ctx->final_chunk)) {
+		conn_state_release(client);
+	}
+
+	return ret;
+}
+
+struct http_resource_detail_dynamic route_resource_detail = {
+	.common = {
+			.type = HTTP_RESOURCE_TYPE_DYNAMIC,
+			.bitmask_of_supported_http_methods =
+				BIT(HTTP_GET) | BIT(HTTP_POST) | BIT(HTTP_PUT) | BIT(HTTP_DELETE),
+		},
+	.cb = route_dispatch,
+	.user_data = NULL,
+};
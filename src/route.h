@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_ROUTE_H_
+#define APP_ROUTE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/net/http/server.h>
+
+/**
+ * @brief A single value captured from the request path
+ *
+ * Both the name and the value point into existing memory (the route pattern
+ * in ROM and the client URL buffer respectively), nothing is copied.
+ */
+struct route_param {
+	const char *name;
+	size_t name_len;
+	const char *value;
+	size_t value_len;
+};
+
+/** @brief Set of values captured while matching a route pattern */
+struct route_params {
+	struct route_param param[CONFIG_NET_SAMPLE_ROUTE_MAX_PARAMS];
+	size_t count;
+};
+
+/**
+ * @brief Route callback, called like a dynamic resource callback
+ *
+ * A response left without final_chunk is called back for its next chunk,
+ * with the request's conn_state kept until then.
+ *
+ * @param client HTTP client context
+ * @param status Data status of this invocation
+ * @param request_ctx Request context (payload chunk, headers)
+ * @param response_ctx Response context to be filled in by the callback
+ * @param params Values captured from the request path
+ *
+ * @return 0 on success, negative errno otherwise
+ */
+typedef int (*route_cb_t)(struct http_client_ctx *client, enum http_data_status status,
+			  const struct http_request_ctx *request_ctx,
+			  struct http_response_ctx *response_ctx,
+			  const struct route_params *params);
+
+/**
+ * @brief Route description
+ *
+ * Pattern syntax:
+ * - "{name}" captures a single, non-empty path segment
+ * - "*name" captures the remainder of the path, must be the last token
+ * - any other character must match literally
+ */
+struct app_route {
+	const char *pattern;
+	uint32_t methods;
+	route_cb_t cb;
+};
+
+/**
+ * @brief Define a route handled by @ref route_dispatch
+ *
+ * The owning HTTP resource must be registered with a wildcard path covering
+ * the pattern (e.g. "/led/*" for "/led/{n}") and use @ref route_resource_detail.
+ *
+ * @param _name Route name
+ * @param _pattern Route pattern
+ * @param _methods Bitmask of supported HTTP methods
+ * @param _cb Route callback
+ */
+#define ROUTE_DEFINE(_name, _pattern, _methods, _cb)                                               \
+	static const STRUCT_SECTION_ITERABLE(app_route, _name) = {                                \
+		.pattern = _pattern,                                                               \
+		.methods = _methods,                                                               \
+		.cb = _cb,                                                                         \
+	}
+
+/** @brief Dynamic resource detail dispatching to the routes defined with ROUTE_DEFINE */
+extern struct http_resource_detail_dynamic route_resource_detail;
+
+/**
+ * @brief Match a path against a route pattern
+ *
+ * @param pattern Route pattern
+ * @param path Request path, not necessarily NUL terminated
+ * @param path_len Length of the path
+ * @param params Captured values, valid as long as pattern and path are
+ *
+ * @return Number of captured values on match, -ENOENT if the path does not
+ *	   match, -ENOMEM if there are more captures than
+ *	   CONFIG_NET_SAMPLE_ROUTE_MAX_PARAMS
+ */
+int route_match(const char *pattern, const char *path, size_t path_len,
+		struct route_params *params);
+
+/**
+ * @brief Look up a captured value by name
+ *
+ * @param params Captured values
+ * @param name Name of the value, as written in the pattern
+ *
+ * @return Pointer to the captured value or NULL if there is none
+ */
+const struct route_param *route_param_get(const struct route_params *params, const char *name);
+
+/**
+ * @brief Convert a captured value to an unsigned integer
+ *
+ * @param params Captured values
+ * @param name Name of the value
+ * @param out Converted value
+ *
+ * @return 0 on success, -ENOENT if there is no such value, -EINVAL if it is
+ *	   not a decimal number
+ */
+int route_param_to_uint(const struct route_params *params, const char *name, uint32_t *out);
+
+#endif /* APP_ROUTE_H_ */
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "http_auth.h"
+#include "led_command.h"
+#include "route.h"
+#include "ws.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+/*
+ * Microbenchmarks of the server's own paths, to compare boards and builds
+ * without host tools. Each one reports its iteration count, the cycles it
+ * took and, where it moves data, the bytes moved. They run in the calling
+ * thread, the HTTP server's one for /bench, which serves nothing else
+ * meanwhile.
+ */
+
+#define BENCH_ITERATIONS CONFIG_NET_SAMPLE_SELF_BENCH_ITERATIONS
+#define BENCH_BUF_SIZE   2048
+#define BENCH_MAX        8
+
+struct bench_result {
+	const char *name;
+	uint32_t iterations;
+	uint32_t cycles;
+	/* Bytes moved over all iterations, 0 if not a throughput test */
+	uint32_t bytes;
+	int err;
+};
+
+static uint8_t bench_src[BENCH_BUF_SIZE];
+static uint8_t bench_dst[BENCH_BUF_SIZE];
+static K_MUTEX_DEFINE(bench_lock);
+
+static const char bench_led_json[] = "{\"led_num\":1,\"led_state\":true}";
+
+static void bench_json_led(struct bench_result *res)
+{
+	struct led_command cmd;
+	uint32_t start = k_cycle_get_32();
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		/* The parser tokenises in place, start from a fresh copy */
+		memcpy(bench_dst, bench_led_json, sizeof(bench_led_json));
+		res->err = led_command_parse(bench_dst, sizeof(bench_led_json) - 1, &cmd);
+		if (res->err < 0) {
+			break;
+		}
+	}
+
+	res->cycles = k_cycle_get_32() - start;
+	res->iterations = BENCH_ITERATIONS;
+}
+
+static void bench_netstats(struct bench_result *res)
+{
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_SERVICE)
+	uint32_t start = k_cycle_get_32();
+	int ret;
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		ret = ws_netstats_json((char *)bench_dst, sizeof(bench_dst));
+		if (ret < 0) {
+			res->err = ret;
+			break;
+		}
+	}
+
+	res->cycles = k_cycle_get_32() - start;
+	res->iterations = BENCH_ITERATIONS;
+#else
+	res->err = -ENOTSUP;
+#endif
+}
+
+static void bench_memcpy(struct bench_result *res)
+{
+	uint32_t start = k_cycle_get_32();
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		memcpy(bench_dst, bench_src, sizeof(bench_dst));
+		/* Keep the compiler from merging the copies */
+		compiler_barrier();
+	}
+
+	res->cycles = k_cycle_get_32() - start;
+	res->iterations = BENCH_ITERATIONS;
+	res->bytes = BENCH_ITERATIONS * sizeof(bench_dst);
+}
+
+static void bench_memset(struct bench_result *res)
+{
+	uint32_t start = k_cycle_get_32();
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		memset(bench_dst, (uint8_t)i, sizeof(bench_dst));
+		compiler_barrier();
+	}
+
+	res->cycles = k_cycle_get_32() - start;
+	res->iterations = BENCH_ITERATIONS;
+	res->bytes = BENCH_ITERATIONS * sizeof(bench_dst);
+}
+
+#if FIXED_PARTITION_EXISTS(lfs1_partition)
+#define BENCH_FLASH_SIZE (8 * BENCH_BUF_SIZE)
+
+static void bench_flash_read(struct bench_result *res)
+{
+	const struct flash_area *fa;
+	uint32_t start;
+
+	res->err = flash_area_open(FIXED_PARTITION_ID(lfs1_partition), &fa);
+	if (res->err < 0) {
+		return;
+	}
+
+	start = k_cycle_get_32();
+
+	for (off_t off = 0; off < BENCH_FLASH_SIZE; off += sizeof(bench_dst)) {
+		res->err = flash_area_read(fa, off, bench_dst, sizeof(bench_dst));
+		if (res->err < 0) {
+			break;
+		}
+	}
+
+	res->cycles = k_cycle_get_32() - start;
+	res->iterations = BENCH_FLASH_SIZE / sizeof(bench_dst);
+	res->bytes = BENCH_FLASH_SIZE;
+
+	flash_area_close(fa);
+}
+
+#if defined(CONFIG_NET_SAMPLE_SELF_BENCH_FLASH_WRITE)
+/* Erases the start of lfs1_partition, which nothing else uses */
+static void bench_flash_write(struct bench_result *erase, struct bench_result *write)
+{
+	const struct flash_area *fa;
+	uint32_t start;
+
+	erase->err = flash_area_open(FIXED_PARTITION_ID(lfs1_partition), &fa);
+	if (erase->err < 0) {
+		write->err = erase->err;
+		return;
+	}
+
+	start = k_cycle_get_32();
+	/* Rounded up to the erase page by flash_area_flatten() on most flash,
+	 * whole sectors of 128 KiB on the STM32F4
+	 */
+	erase->err = flash_area_flatten(fa, 0, BENCH_FLASH_SIZE);
+	erase->cycles = k_cycle_get_32() - start;
+	erase->iterations = 1;
+	erase->bytes = BENCH_FLASH_SIZE;
+
+	if (erase->err < 0) {
+		write->err = erase->err;
+		goto out;
+	}
+
+	for (size_t i = 0; i < sizeof(bench_src); i++) {
+		bench_src[i] = (uint8_t)i;
+	}
+
+	start = k_cycle_get_32();
+
+	for (off_t off = 0; off < BENCH_FLASH_SIZE; off += sizeof(bench_src)) {
+		write->err = flash_area_write(fa, off, bench_src, sizeof(bench_src));
+		if (write->err < 0) {
+			break;
+		}
+	}
+
+	write->cycles = k_cycle_get_32() - start;
+	write->iterations = BENCH_FLASH_SIZE / sizeof(bench_src);
+	write->bytes = BENCH_FLASH_SIZE;
+
+out:
+	flash_area_close(fa);
+}
+#endif /* CONFIG_NET_SAMPLE_SELF_BENCH_FLASH_WRITE */
+#endif /* FIXED_PARTITION_EXISTS(lfs1_partition) */
+
+/* Datagrams to an address of our own are looped back inside the IP stack
+ * without reaching the driver, so a round trip goes down and up the socket
+ * layer, UDP and IPv4 twice. 127.0.0.1 would need the loopback interface,
+ * which the sample does not enable, so the default interface's address is
+ * used and the server socket listens on any address.
+ */
+static void bench_udp_loopback(struct bench_result *res)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	struct sockaddr_in peer;
+	socklen_t addrlen = sizeof(addr);
+	struct zsock_timeval tv = {.tv_sec = 1};
+	struct net_if *iface = net_if_get_default();
+	struct in_addr *own = NULL;
+	int server = -1;
+	int client = -1;
+	uint32_t start;
+	uint32_t i;
+	int ret = 0;
+
+	if (iface != NULL) {
+		own = net_if_ipv4_get_global_addr(iface, NET_ADDR_PREFERRED);
+	}
+
+	if (own == NULL) {
+		res->err = -ENETUNREACH;
+		return;
+	}
+
+	server = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	client = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (server < 0 || client < 0) {
+		res->err = -errno;
+		goto out;
+	}
+
+	if (zsock_bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    zsock_getsockname(server, (struct sockaddr *)&addr, &addrlen) < 0 ||
+	    zsock_setsockopt(server, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0 ||
+	    zsock_setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
+		res->err = -errno;
+		goto out;
+	}
+
+	/* Bound port, sent to on our own address */
+	addr.sin_addr = *own;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < CONFIG_NET_SAMPLE_SELF_BENCH_ROUND_TRIPS; i++) {
+		ret = zsock_sendto(client, bench_src, 64, 0, (struct sockaddr *)&addr,
+				   sizeof(addr));
+		if (ret < 0) {
+			break;
+		}
+
+		addrlen = sizeof(peer);
+		ret = zsock_recvfrom(server, bench_dst, sizeof(bench_dst), 0,
+				     (struct sockaddr *)&peer, &addrlen);
+		if (ret < 0) {
+			break;
+		}
+
+		ret = zsock_sendto(server, bench_dst, ret, 0, (struct sockaddr *)&peer, addrlen);
+		if (ret < 0) {
+			break;
+		}
+
+		ret = zsock_recv(client, bench_dst, sizeof(bench_dst), 0);
+		if (ret < 0) {
+			break;
+		}
+	}
+
+	res->cycles = k_cycle_get_32() - start;
+	res->iterations = i;
+	if (ret < 0) {
+		res->err = -errno;
+	}
+
+out:
+	if (server >= 0) {
+		zsock_close(server);
+	}
+
+	if (client >= 0) {
+		zsock_close(client);
+	}
+}
+
+/* Flash write benchmarks erase a sector, a remote run needs the token */
+static int self_bench_run(struct bench_result *results, bool flash_write)
+{
+	int count = 0;
+
+	if (k_mutex_lock(&bench_lock, K_NO_WAIT) < 0) {
+		return -EBUSY;
+	}
+
+	memset(results, 0, BENCH_MAX * sizeof(*results));
+
+	results[count].name = "json_led_parse";
+	bench_json_led(&results[count++]);
+
+	results[count].name = "netstats_format";
+	bench_netstats(&results[count++]);
+
+	results[count].name = "memcpy";
+	bench_memcpy(&results[count++]);
+
+	results[count].name = "memset";
+	bench_memset(&results[count++]);
+
+#if FIXED_PARTITION_EXISTS(lfs1_partition)
+	results[count].name = "flash_read";
+	bench_flash_read(&results[count++]);
+
+#if defined(CONFIG_NET_SAMPLE_SELF_BENCH_FLASH_WRITE)
+	results[count].name = "flash_erase";
+	results[count + 1].name = "flash_write";
+	if (flash_write) {
+		bench_flash_write(&results[count], &results[count + 1]);
+	} else {
+		results[count].err = -EACCES;
+		results[count + 1].err = -EACCES;
+	}
+	count += 2;
+#endif
+#endif
+
+	results[count].name = "udp_loopback_rtt";
+	bench_udp_loopback(&results[count++]);
+
+	k_mutex_unlock(&bench_lock);
+
+	return count;
+}
+
+/* Bytes per second from a byte count and the cycles it took */
+static uint64_t bench_rate(const struct bench_result *res)
+{
+	if (res->cycles == 0) {
+		return 0;
+	}
+
+	return (uint64_t)res->bytes * sys_clock_hw_cycles_per_sec() / res->cycles;
+}
+
+static int self_bench_handler(struct http_client_ctx *client, enum http_data_status status,
+			      const struct http_request_ctx *request_ctx,
+			      struct http_response_ctx *response_ctx,
+			      const struct route_params *params)
+{
+	static char json_buf[64 + 160 * BENCH_MAX];
+	struct bench_result results[BENCH_MAX];
+	bool flash_write = false;
+	size_t len;
+	int count;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+#if defined(CONFIG_NET_SAMPLE_SELF_BENCH_FLASH_WRITE)
+	flash_write = http_auth_bearer_ok(request_ctx);
+#endif
+
+	count = self_bench_run(results, flash_write);
+	if (count < 0) {
+		response_ctx->status = HTTP_503_SERVICE_UNAVAILABLE;
+		response_ctx->final_chunk = true;
+		return 0;
+	}
+
+	len = snprintf(json_buf, sizeof(json_buf), "{\"hz\":%u,\"results\":[",
+		       sys_clock_hw_cycles_per_sec());
+
+	for (int i = 0; i < count && len < sizeof(json_buf); i++) {
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len,
+				"%s{\"name\":\"%s\",\"iterations\":%u,\"cycles\":%u,"
+				"\"cycles_per_iter\":%u,\"bytes\":%u,\"bytes_per_s\":%llu,"
+				"\"err\":%d}",
+				i > 0 ? "," : "", results[i].name,
+				(unsigned int)results[i].iterations,
+				(unsigned int)results[i].cycles,
+				(unsigned int)(results[i].iterations ?
+					       results[i].cycles / results[i].iterations : 0),
+				(unsigned int)results[i].bytes,
+				(unsigned long long)bench_rate(&results[i]), results[i].err);
+	}
+
+	if (len < sizeof(json_buf)) {
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len, "]}");
+	}
+
+	if (len >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = len;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(self_bench_route, "/bench", BIT(HTTP_GET), self_bench_handler);
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+
+static int cmd_bench(const struct shell *sh, size_t argc, char **argv)
+{
+	struct bench_result results[BENCH_MAX];
+	bool flash_write = false;
+	int count;
+
+	/* Erasing flash wears it, so it only runs when asked for */
+	if (argc > 1) {
+		if (strcmp(argv[1], "flash") != 0) {
+			shell_error(sh, "Unknown argument %s", argv[1]);
+			return -EINVAL;
+		}
+
+		flash_write = true;
+	}
+
+	count = self_bench_run(results, flash_write);
+	if (count < 0) {
+		shell_error(sh, "A benchmark is already running");
+		return count;
+	}
+
+	shell_print(sh, "%-18s %10s %12s %12s %12s", "name", "iterations", "cycles",
+		    "cycles/iter", "KiB/s");
+
+	for (int i = 0; i < count; i++) {
+		if (results[i].err < 0) {
+			shell_print(sh, "%-18s failed, err %d", results[i].name, results[i].err);
+			continue;
+		}
+
+		shell_print(sh, "%-18s %10u %12u %12u %12u", results[i].name,
+			    (unsigned int)results[i].iterations, (unsigned int)results[i].cycles,
+			    (unsigned int)(results[i].iterations ?
+					   results[i].cycles / results[i].iterations : 0),
+			    (unsigned int)(bench_rate(&results[i]) / 1024));
+	}
+
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(bench, NULL,
+		       "Run the built-in microbenchmarks, \"bench flash\" also erases and "
+		       "writes flash",
+		       cmd_bench, 1, 1);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/spsc_lockfree.h>
+
+#include "route.h"
+#include "sensor_stream.h"
+#include "ws.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define SENSOR_STREAM_STACK_SIZE 1024
+#define SENSOR_STREAM_PRIORITY K_PRIO_PREEMPT(7)
+
+/* Bytes in front of the data of every sample in a batch */
+#define SENSOR_SAMPLE_HDR_LEN 6
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_NET_SAMPLE_SENSOR_STREAM_RING),
+	     "Sensor ring size must be a power of two");
+BUILD_ASSERT(CONFIG_NET_SAMPLE_SENSOR_I2C_LEN <= SENSOR_STREAM_MAX_LEN);
+
+struct sensor_source {
+	uint16_t addr;
+	uint8_t reg;
+	uint8_t len;
+};
+
+/* Register blocks read on every tick, in this order. Add an entry per
+ * sensor on the bus.
+ */
+static const struct sensor_source sensor_sources[] = {
+	{
+		.addr = CONFIG_NET_SAMPLE_SENSOR_I2C_ADDR,
+		.reg = CONFIG_NET_SAMPLE_SENSOR_I2C_REG,
+		.len = CONFIG_NET_SAMPLE_SENSOR_I2C_LEN,
+	},
+};
+
+struct sensor_sample {
+	uint32_t timestamp;
+	uint8_t source;
+	/* 0 if the read failed */
+	uint8_t len;
+	uint8_t data[SENSOR_STREAM_MAX_LEN];
+};
+
+/* Filled by the acquisition side (transfer callback or thread), drained by
+ * the websocket push thread. Single producer, single consumer, no locks.
+ */
+SPSC_DEFINE(sensor_ring, struct sensor_sample, CONFIG_NET_SAMPLE_SENSOR_STREAM_RING);
+
+static const struct device *const sensor_bus = DEVICE_DT_GET(DT_ALIAS(sensor_i2c));
+
+K_TIMER_DEFINE(sensor_timer, NULL, NULL);
+
+/* State of the transfers of the current tick */
+static struct i2c_msg sensor_msgs[2];
+static uint8_t sensor_reg;
+static struct sensor_sample *sensor_pending;
+static size_t sensor_next;
+static uint32_t sensor_stamp;
+static atomic_t sensor_busy;
+static bool sensor_async = IS_ENABLED(CONFIG_I2C_CALLBACK);
+
+static int64_t sensor_start;
+static atomic_t stat_samples;
+static atomic_t stat_dropped;
+static atomic_t stat_overruns;
+static atomic_t stat_errors;
+static atomic_t stat_batches;
+
+static int sensor_read_prepare(size_t idx)
+{
+	const struct sensor_source *src = &sensor_sources[idx];
+
+	sensor_pending = spsc_acquire(&sensor_ring);
+	if (sensor_pending == NULL) {
+		atomic_inc(&stat_dropped);
+		return -ENOBUFS;
+	}
+
+	sensor_pending->timestamp = sensor_stamp;
+	sensor_pending->source = idx;
+	sensor_pending->len = src->len;
+
+	sensor_reg = src->reg;
+	sensor_msgs[0].buf = &sensor_reg;
+	sensor_msgs[0].len = sizeof(sensor_reg);
+	sensor_msgs[0].flags = I2C_MSG_WRITE;
+	sensor_msgs[1].buf = sensor_pending->data;
+	sensor_msgs[1].len = src->len;
+	sensor_msgs[1].flags = I2C_MSG_RESTART | I2C_MSG_READ | I2C_MSG_STOP;
+
+	return 0;
+}
+
+/* A ring slot cannot be given back once acquired, so failed reads are
+ * published too and skipped by the consumer.
+ */
+static void sensor_read_finish(int result)
+{
+	if (result < 0) {
+		sensor_pending->len = 0;
+		atomic_inc(&stat_errors);
+	} else {
+		atomic_inc(&stat_samples);
+	}
+
+	spsc_produce(&sensor_ring);
+
+	if (spsc_consumable(&sensor_ring) >= CONFIG_NET_SAMPLE_SENSOR_STREAM_BATCH) {
+		ws_notify(WS_TOPIC_SENSOR);
+	}
+}
+
+#if defined(CONFIG_I2C_CALLBACK)
+static void sensor_read_cb(const struct device *dev, int result, void *user_data);
+#endif
+
+/* Read the remaining sources of this tick. With a driver that completes
+ * transfers from its interrupt, only the first transfer is started here
+ * and each completion starts the next one, so no thread waits on the bus.
+ * Returns true while such a chain is running.
+ */
+static bool sensor_read_next(void)
+{
+	const struct sensor_source *src;
+	int ret;
+
+	for (; sensor_next < ARRAY_SIZE(sensor_sources); sensor_next++) {
+		src = &sensor_sources[sensor_next];
+
+		if (sensor_read_prepare(sensor_next) < 0) {
+			continue;
+		}
+
+		ret = -ENOSYS;
+#if defined(CONFIG_I2C_CALLBACK)
+		if (sensor_async) {
+			ret = i2c_transfer_cb(sensor_bus, sensor_msgs, ARRAY_SIZE(sensor_msgs),
+					      src->addr, sensor_read_cb, NULL);
+			if (ret == 0) {
+				return true;
+			}
+		}
+#endif
+		if (ret == -ENOSYS) {
+			if (sensor_async) {
+				LOG_INF("I2C driver has no async transfers, reading from thread");
+				sensor_async = false;
+			}
+
+			ret = i2c_transfer(sensor_bus, sensor_msgs, ARRAY_SIZE(sensor_msgs),
+					   src->addr);
+		}
+
+		sensor_read_finish(ret);
+	}
+
+	return false;
+}
+
+#if defined(CONFIG_I2C_CALLBACK)
+static void sensor_read_cb(const struct device *dev, int result, void *user_data)
+{
+	sensor_read_finish(result);
+
+	sensor_next++;
+	if (!sensor_read_next()) {
+		atomic_clear(&sensor_busy);
+	}
+}
+#endif
+
+static void sensor_stream_thread(void *p1, void *p2, void *p3)
+{
+	k_timeout_t period = K_USEC(USEC_PER_SEC / CONFIG_NET_SAMPLE_SENSOR_STREAM_RATE);
+	uint32_t expired;
+
+	if (!device_is_ready(sensor_bus)) {
+		LOG_ERR("Sensor bus %s is not ready", sensor_bus->name);
+		return;
+	}
+
+	sensor_start = k_uptime_get();
+	k_timer_start(&sensor_timer, period, period);
+
+	while (true) {
+		expired = k_timer_status_sync(&sensor_timer);
+		if (expired > 1) {
+			atomic_add(&stat_overruns, expired - 1);
+		}
+
+		/* The transfers of the previous tick are still going on */
+		if (!atomic_cas(&sensor_busy, 0, 1)) {
+			atomic_inc(&stat_overruns);
+			continue;
+		}
+
+		sensor_stamp = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+		sensor_next = 0;
+
+		if (!sensor_read_next()) {
+			atomic_clear(&sensor_busy);
+		}
+	}
+}
+
+K_THREAD_DEFINE(sensor_stream_tid, SENSOR_STREAM_STACK_SIZE, sensor_stream_thread, NULL, NULL,
+		NULL, SENSOR_STREAM_PRIORITY, 0, 0);
+
+int sensor_stream_collect(char *buf, size_t maxlen, uint32_t *stamp)
+{
+	uint8_t *out = (uint8_t *)buf;
+	struct sensor_sample *sample;
+	size_t len = sizeof(uint16_t);
+	uint16_t count = 0;
+
+	while (len + SENSOR_SAMPLE_HDR_LEN + SENSOR_STREAM_MAX_LEN <= maxlen) {
+		sample = spsc_consume(&sensor_ring);
+		if (sample == NULL) {
+			break;
+		}
+
+		if (sample->len > 0) {
+			sys_put_le32(sample->timestamp, &out[len]);
+			out[len + 4] = sample->source;
+			out[len + 5] = sample->len;
+			memcpy(&out[len + SENSOR_SAMPLE_HDR_LEN], sample->data, sample->len);
+			len += SENSOR_SAMPLE_HDR_LEN + sample->len;
+			count++;
+		}
+
+		spsc_release(&sensor_ring);
+	}
+
+	if (spsc_consumable(&sensor_ring) >= CONFIG_NET_SAMPLE_SENSOR_STREAM_BATCH) {
+		ws_notify(WS_TOPIC_SENSOR);
+	}
+
+	if (count == 0) {
+		return -ENODATA;
+	}
+
+	sys_put_le16(count, out);
+	atomic_inc(&stat_batches);
+
+	return len;
+}
+
+static int sensor_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+				const struct http_request_ctx *request_ctx,
+				struct http_response_ctx *response_ctx,
+				const struct route_params *params)
+{
+	static char json_buf[192];
+	int64_t elapsed = k_uptime_get() - sensor_start;
+	uint32_t samples = atomic_get(&stat_samples);
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = snprintf(json_buf, sizeof(json_buf),
+		       "{"
+		       "\"rate\":%u,"
+		       "\"measured\":%u,"
+		       "\"samples\":%u,"
+		       "\"dropped\":%u,"
+		       "\"overruns\":%u,"
+		       "\"errors\":%u,"
+		       "\"batches\":%u,"
+		       "\"async\":%s"
+		       "}",
+		       CONFIG_NET_SAMPLE_SENSOR_STREAM_RATE,
+		       (uint32_t)(elapsed > 0 ? samples * 1000LL / elapsed : 0), samples,
+		       (uint32_t)atomic_get(&stat_dropped), (uint32_t)atomic_get(&stat_overruns),
+		       (uint32_t)atomic_get(&stat_errors), (uint32_t)atomic_get(&stat_batches),
+		       sensor_async ? "true" : "false");
+	if (ret >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(sensor_stats_route, "/stats/sensor", BIT(HTTP_GET), sensor_stats_handler);
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SENSOR_STREAM_H_
+#define APP_SENSOR_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sensor batches are binary websocket messages of little endian fields:
+ *
+ *  u16 count                     samples in this batch
+ *  count times:
+ *   u32 timestamp                microseconds of uptime, wrapping
+ *   u8 source                    index in the source table
+ *   u8 len                       register bytes that follow
+ *   u8 data[len]                 as read from the sensor
+ */
+
+/** Largest register block read from one source */
+#define SENSOR_STREAM_MAX_LEN 16
+
+/**
+ * @brief Move buffered samples into one batch message
+ *
+ * Called by the websocket push thread for WS_TOPIC_SENSOR. If more samples
+ * are left than fit, the topic is notified again.
+ *
+ * @param buf Output buffer
+ * @param maxlen Size of the output buffer
+ * @param stamp Unused, samples carry their own timestamps
+ *
+ * @return Length of the batch on success, negative errno otherwise
+ */
+int sensor_stream_collect(char *buf, size_t maxlen, uint32_t *stamp);
+
+#endif /* APP_SENSOR_STREAM_H_ */
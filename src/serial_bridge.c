@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include "route.h"
+#include "serial_bridge.h"
+#include "startup.h"
+#include "ws.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define SERIAL_RX_CHUNK 64
+
+static const struct device *const bridge_uart = DEVICE_DT_GET(DT_ALIAS(bridge_uart));
+
+/* The driver receives into one chunk while the previous one is copied out */
+static uint8_t serial_rx_chunks[2][SERIAL_RX_CHUNK];
+static uint8_t serial_rx_next;
+
+RING_BUF_DECLARE(serial_rx_ring, CONFIG_NET_SAMPLE_SERIAL_BRIDGE_RX_RING);
+RING_BUF_DECLARE(serial_tx_ring, CONFIG_NET_SAMPLE_SERIAL_BRIDGE_TX_RING);
+static struct k_spinlock serial_tx_lock;
+static size_t serial_tx_len;
+
+static uint32_t serial_baud;
+static atomic_t stat_rx_bytes;
+static atomic_t stat_tx_bytes;
+static atomic_t stat_rx_overruns;
+static atomic_t stat_tx_overruns;
+static atomic_t stat_uart_overruns;
+static atomic_t stat_errors;
+
+/* Called with serial_tx_lock held. The claimed part of the ring stays
+ * untouched by writers until the driver reports it sent.
+ */
+static void serial_tx_start(void)
+{
+	uint8_t *data;
+	int ret;
+
+	if (serial_tx_len > 0) {
+		return;
+	}
+
+	serial_tx_len = ring_buf_get_claim(&serial_tx_ring, &data,
+					   CONFIG_NET_SAMPLE_SERIAL_BRIDGE_TX_RING);
+	if (serial_tx_len == 0) {
+		return;
+	}
+
+	ret = uart_tx(bridge_uart, data, serial_tx_len, SYS_FOREVER_US);
+	if (ret < 0) {
+		LOG_ERR("Failed to start UART transmission, err %d", ret);
+		(void)ring_buf_get_finish(&serial_tx_ring, serial_tx_len);
+		serial_tx_len = 0;
+		atomic_inc(&stat_errors);
+	}
+}
+
+static void serial_tx_done(size_t len)
+{
+	k_spinlock_key_t key = k_spin_lock(&serial_tx_lock);
+
+	(void)ring_buf_get_finish(&serial_tx_ring, serial_tx_len);
+	serial_tx_len = 0;
+	atomic_add(&stat_tx_bytes, len);
+
+	serial_tx_start();
+	k_spin_unlock(&serial_tx_lock, key);
+}
+
+void serial_bridge_write(const uint8_t *data, size_t len)
+{
+	k_spinlock_key_t key = k_spin_lock(&serial_tx_lock);
+	uint32_t put;
+
+	put = ring_buf_put(&serial_tx_ring, data, len);
+	if (put < len) {
+		atomic_add(&stat_tx_overruns, len - put);
+	}
+
+	serial_tx_start();
+	k_spin_unlock(&serial_tx_lock, key);
+}
+
+static void serial_uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+	uint32_t put;
+
+	switch (evt->type) {
+	case UART_TX_DONE:
+	case UART_TX_ABORTED:
+		serial_tx_done(evt->data.tx.len);
+		break;
+
+	case UART_RX_RDY:
+		/* Reported when the chunk is full or the line went idle for
+		 * the configured time, so bursts leave as one message.
+		 */
+		put = ring_buf_put(&serial_rx_ring, &evt->data.rx.buf[evt->data.rx.offset],
+				   evt->data.rx.len);
+		atomic_add(&stat_rx_bytes, put);
+		if (put < evt->data.rx.len) {
+			atomic_add(&stat_rx_overruns, evt->data.rx.len - put);
+		}
+
+		ws_notify(WS_TOPIC_SERIAL);
+		break;
+
+	case UART_RX_BUF_REQUEST:
+		(void)uart_rx_buf_rsp(dev, serial_rx_chunks[serial_rx_next],
+				      sizeof(serial_rx_chunks[0]));
+		serial_rx_next ^= 1;
+		break;
+
+	case UART_RX_STOPPED:
+		if (evt->data.rx_stop.reason & UART_ERROR_OVERRUN) {
+			atomic_inc(&stat_uart_overruns);
+		} else {
+			atomic_inc(&stat_errors);
+		}
+		break;
+
+	case UART_RX_DISABLED:
+		/* Errors stop reception, pick up again */
+		serial_rx_next = 1;
+		(void)uart_rx_enable(dev, serial_rx_chunks[0], sizeof(serial_rx_chunks[0]),
+				     CONFIG_NET_SAMPLE_SERIAL_BRIDGE_IDLE_US);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static int serial_bridge_set_baud(uint32_t baud)
+{
+	struct uart_config cfg;
+	int ret;
+
+	ret = uart_config_get(bridge_uart, &cfg);
+	if (ret < 0) {
+		return ret;
+	}
+
+	cfg.baudrate = baud;
+
+	ret = uart_configure(bridge_uart, &cfg);
+	if (ret < 0) {
+		return ret;
+	}
+
+	serial_baud = baud;
+
+	return 0;
+}
+
+int serial_bridge_collect(char *buf, size_t maxlen, uint32_t *stamp)
+{
+	uint32_t len;
+
+	len = ring_buf_get(&serial_rx_ring, (uint8_t *)buf, maxlen);
+
+	if (!ring_buf_is_empty(&serial_rx_ring)) {
+		ws_notify(WS_TOPIC_SERIAL);
+	}
+
+	return len > 0 ? len : -ENODATA;
+}
+
+static int serial_bridge_init(void)
+{
+	struct uart_config cfg;
+	int ret;
+
+	if (!device_is_ready(bridge_uart)) {
+		LOG_ERR("Bridge UART %s is not ready", bridge_uart->name);
+		return 0;
+	}
+
+	if (CONFIG_NET_SAMPLE_SERIAL_BRIDGE_BAUD > 0) {
+		ret = serial_bridge_set_baud(CONFIG_NET_SAMPLE_SERIAL_BRIDGE_BAUD);
+		if (ret < 0) {
+			LOG_ERR("Failed to set bridge baud rate, err %d", ret);
+		}
+	}
+
+	if (serial_baud == 0 && uart_config_get(bridge_uart, &cfg) == 0) {
+		serial_baud = cfg.baudrate;
+	}
+
+	ret = uart_callback_set(bridge_uart, serial_uart_cb, NULL);
+	if (ret < 0) {
+		LOG_ERR("Bridge UART has no async API, err %d", ret);
+		return 0;
+	}
+
+	serial_rx_next = 1;
+	ret = uart_rx_enable(bridge_uart, serial_rx_chunks[0], sizeof(serial_rx_chunks[0]),
+			     CONFIG_NET_SAMPLE_SERIAL_BRIDGE_IDLE_US);
+	if (ret < 0) {
+		LOG_ERR("Failed to enable bridge reception, err %d", ret);
+	}
+
+	return 0;
+}
+STARTUP_TASK_DEFINE(serial_bridge, STARTUP_SERIAL_BRIDGE, 0, serial_bridge_init);
+
+static int serial_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+				const struct http_request_ctx *request_ctx,
+				struct http_response_ctx *response_ctx,
+				const struct route_params *params)
+{
+	static char json_buf[192];
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = snprintf(json_buf, sizeof(json_buf),
+		       "{"
+		       "\"baud\":%u,"
+		       "\"rx_bytes\":%u,"
+		       "\"tx_bytes\":%u,"
+		       "\"rx_overruns\":%u,"
+		       "\"tx_overruns\":%u,"
+		       "\"uart_overruns\":%u,"
+		       "\"errors\":%u"
+		       "}",
+		       serial_baud, (uint32_t)atomic_get(&stat_rx_bytes),
+		       (uint32_t)atomic_get(&stat_tx_bytes),
+		       (uint32_t)atomic_get(&stat_rx_overruns),
+		       (uint32_t)atomic_get(&stat_tx_overruns),
+		       (uint32_t)atomic_get(&stat_uart_overruns),
+		       (uint32_t)atomic_get(&stat_errors));
+	if (ret >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(serial_stats_route, "/stats/serial", BIT(HTTP_GET), serial_stats_handler);
+
+static int serial_baud_handler(struct http_client_ctx *client, enum http_data_status status,
+			       const struct http_request_ctx *request_ctx,
+			       struct http_response_ctx *response_ctx,
+			       const struct route_params *params)
+{
+	uint32_t baud;
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = route_param_to_uint(params, "rate", &baud);
+	if (ret < 0 || baud == 0) {
+		response_ctx->status = HTTP_400_BAD_REQUEST;
+		response_ctx->final_chunk = true;
+		return 0;
+	}
+
+	ret = serial_bridge_set_baud(baud);
+	if (ret < 0) {
+		LOG_ERR("Failed to set bridge baud rate %u, err %d", baud, ret);
+		response_ctx->status = HTTP_400_BAD_REQUEST;
+	}
+
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(serial_baud_route, "/serial/baud/{rate}", BIT(HTTP_POST), serial_baud_handler);
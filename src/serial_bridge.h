@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SERIAL_BRIDGE_H_
+#define APP_SERIAL_BRIDGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Move received UART data into one binary message
+ *
+ * Called by the websocket push thread for WS_TOPIC_SERIAL.
+ *
+ * @param buf Output buffer
+ * @param maxlen Size of the output buffer
+ * @param stamp Unused
+ *
+ * @return Length of the message on success, -ENODATA if nothing was received
+ */
+int serial_bridge_collect(char *buf, size_t maxlen, uint32_t *stamp);
+
+/**
+ * @brief Queue data from a websocket client for transmission on the UART
+ *
+ * Data that does not fit in the transmit ring is dropped and counted.
+ *
+ * @param data Data to send
+ * @param len Length of the data
+ */
+void serial_bridge_write(const uint8_t *data, size_t len);
+
+#endif /* APP_SERIAL_BRIDGE_H_ */
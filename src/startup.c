@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/spinlock.h>
+
+#include "placement.h"
+#include "route.h"
+#include "startup.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define STARTUP_ALL_DONE BIT_MASK(STARTUP_TASK_COUNT)
+
+BUILD_ASSERT(STARTUP_TASK_COUNT <= 32, "dependency masks are 32 bits wide");
+
+struct startup_state {
+	struct k_work work;
+	const struct startup_task *task;
+	/* Uptime in microseconds at which the task was queued, started and done */
+	int64_t queued_us;
+	int64_t start_us;
+	int64_t end_us;
+	int err;
+};
+
+static struct startup_state startup_states[STARTUP_TASK_COUNT];
+static uint32_t startup_done_mask;
+static uint32_t startup_queued_mask;
+static unsigned int startup_next_queue;
+static struct k_spinlock startup_lock;
+static K_SEM_DEFINE(startup_done_sem, 0, 1);
+
+/* Uptime at which main() started the graph and all tasks were done */
+static int64_t startup_main_us = -1;
+static int64_t startup_done_us = -1;
+
+static struct k_work_q startup_queues[CONFIG_NET_SAMPLE_STARTUP_THREADS];
+APP_CCM_STACK_ARRAY_DEFINE(startup_stacks, CONFIG_NET_SAMPLE_STARTUP_THREADS,
+			   CONFIG_NET_SAMPLE_STARTUP_STACK_SIZE);
+
+static inline int64_t startup_now_us(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/* Queue every task whose dependencies are done, with startup_lock held */
+static void startup_queue_ready(void)
+{
+	struct startup_state *state;
+
+	for (int id = 0; id < STARTUP_TASK_COUNT; id++) {
+		state = &startup_states[id];
+
+		if ((startup_queued_mask & BIT(id)) ||
+		    (state->task->deps & startup_done_mask) != state->task->deps) {
+			continue;
+		}
+
+		startup_queued_mask |= BIT(id);
+		state->queued_us = startup_now_us();
+
+		/* Spread ready tasks so that a blocking one does not hold back
+		 * the others
+		 */
+		k_work_submit_to_queue(&startup_queues[startup_next_queue], &state->work);
+		startup_next_queue = (startup_next_queue + 1) % ARRAY_SIZE(startup_queues);
+	}
+}
+
+static void startup_work_handler(struct k_work *work)
+{
+	struct startup_state *state = CONTAINER_OF(work, struct startup_state, work);
+	k_spinlock_key_t key;
+
+	state->start_us = startup_now_us();
+	state->err = state->task->fn();
+	state->end_us = startup_now_us();
+
+	if (state->err < 0) {
+		LOG_ERR("Startup task %s failed, err %d", state->task->name, state->err);
+	}
+
+	key = k_spin_lock(&startup_lock);
+
+	startup_done_mask |= BIT(state->task->id);
+	startup_queue_ready();
+
+	if (startup_done_mask == STARTUP_ALL_DONE) {
+		startup_done_us = state->end_us;
+		k_sem_give(&startup_done_sem);
+	}
+
+	k_spin_unlock(&startup_lock, key);
+}
+
+static void startup_log_timeline(void)
+{
+	struct startup_state *state;
+
+	LOG_INF("Startup: main at %lld us, done at %lld us", (long long)startup_main_us,
+		(long long)startup_done_us);
+
+	for (int id = 0; id < STARTUP_TASK_COUNT; id++) {
+		state = &startup_states[id];
+		if (state->start_us < 0) {
+			continue;
+		}
+
+		LOG_INF("  %-16s %8lld .. %8lld us (+%lld waiting) err %d", state->task->name,
+			(long long)state->start_us, (long long)state->end_us,
+			(long long)(state->start_us - state->queued_us), state->err);
+	}
+}
+
+int startup_run(void)
+{
+	static const struct startup_task absent = {.name = "absent"};
+	k_spinlock_key_t key;
+
+	startup_main_us = startup_now_us();
+
+	for (int id = 0; id < STARTUP_TASK_COUNT; id++) {
+		startup_states[id].task = &absent;
+		startup_states[id].start_us = -1;
+		startup_states[id].end_us = -1;
+		/* Tasks of modules left out of the build are done already */
+		startup_done_mask |= BIT(id);
+		startup_queued_mask |= BIT(id);
+	}
+
+	STRUCT_SECTION_FOREACH(startup_task, task) {
+		__ASSERT(task->id < STARTUP_TASK_COUNT, "bad startup task id");
+
+		startup_states[task->id].task = task;
+		k_work_init(&startup_states[task->id].work, startup_work_handler);
+		startup_done_mask &= ~BIT(task->id);
+		startup_queued_mask &= ~BIT(task->id);
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(startup_queues); i++) {
+		k_work_queue_start(&startup_queues[i], startup_stacks[i],
+				   K_KERNEL_STACK_SIZEOF(startup_stacks[i]), K_PRIO_PREEMPT(8),
+				   &(struct k_work_queue_config){.name = "startup"});
+	}
+
+	key = k_spin_lock(&startup_lock);
+
+	if (startup_done_mask == STARTUP_ALL_DONE) {
+		startup_done_us = startup_now_us();
+		k_sem_give(&startup_done_sem);
+	} else {
+		startup_queue_ready();
+	}
+
+	k_spin_unlock(&startup_lock, key);
+
+	k_sem_take(&startup_done_sem, K_FOREVER);
+
+	startup_log_timeline();
+
+	return 0;
+}
+
+/* Per task timeline of the last boot, in microseconds of uptime. "ready"
+ * is when the HTTP server was started, the boot to ready metric.
+ */
+static int startup_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+				 const struct http_request_ctx *request_ctx,
+				 struct http_response_ctx *response_ctx,
+				 const struct route_params *params)
+{
+	static char json_buf[96 + 96 * STARTUP_TASK_COUNT];
+	const struct startup_state *state;
+	bool first = true;
+	size_t len;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	len = snprintf(json_buf, sizeof(json_buf),
+		       "{\"main_us\":%lld,\"ready_us\":%lld,\"done_us\":%lld,\"tasks\":[",
+		       (long long)startup_main_us,
+		       (long long)startup_states[STARTUP_HTTP_SERVER].end_us,
+		       (long long)startup_done_us);
+
+	for (int id = 0; id < STARTUP_TASK_COUNT && len < sizeof(json_buf); id++) {
+		state = &startup_states[id];
+		if (state->start_us < 0) {
+			continue;
+		}
+
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len,
+				"%s{\"name\":\"%s\",\"queued_us\":%lld,\"start_us\":%lld,"
+				"\"end_us\":%lld,\"err\":%d}",
+				first ? "" : ",", state->task->name, (long long)state->queued_us,
+				(long long)state->start_us, (long long)state->end_us, state->err);
+		first = false;
+	}
+
+	if (len < sizeof(json_buf)) {
+		len += snprintf(&json_buf[len], sizeof(json_buf) - len, "]}");
+	}
+
+	if (len >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = len;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(startup_stats_route, "/stats/startup", BIT(HTTP_GET), startup_stats_handler);
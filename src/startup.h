@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_STARTUP_H_
+#define APP_STARTUP_H_
+
+#include <stdint.h>
+
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/util.h>
+
+/*
+ * Application init runs as a graph of tasks rather than SYS_INIT hooks and
+ * a sequence in main(). A task is queued as soon as the tasks it depends on
+ * are done, so the HTTP listener comes up while slow flash and USB work is
+ * still going on. Tasks of modules left out of the build count as done.
+ */
+
+/** @brief Identifiers of the startup tasks, used in dependency masks */
+enum startup_task_id {
+	STARTUP_HTTPS_CREDENTIALS,
+	STARTUP_WS_PUSH,
+	STARTUP_WS_SHELL,
+	STARTUP_HTTP_SERVER,
+	STARTUP_SERIAL_BRIDGE,
+	STARTUP_DHCP_LEASE,
+	STARTUP_BOOT_REQUEST,
+	STARTUP_USB,
+	STARTUP_CRASH_DUMP,
+	STARTUP_FW_SLOTS,
+	STARTUP_TASK_COUNT,
+};
+
+struct startup_task {
+	const char *name;
+	enum startup_task_id id;
+	/* BIT() of every task that must be done first */
+	uint32_t deps;
+	int (*fn)(void);
+};
+
+/**
+ * @brief Define a startup task
+ *
+ * A task that fails is logged and still counts as done for its dependents.
+ *
+ * @param _name Task name, shown in the startup timeline
+ * @param _id Task identifier from enum startup_task_id
+ * @param _deps Mask of the tasks to wait for
+ * @param _fn Init function
+ */
+#define STARTUP_TASK_DEFINE(_name, _id, _deps, _fn)                                                \
+	static const STRUCT_SECTION_ITERABLE(startup_task, _name) = {                            \
+		.name = #_name,                                                                    \
+		.id = _id,                                                                         \
+		.deps = _deps,                                                                     \
+		.fn = _fn,                                                                         \
+	}
+
+/**
+ * @brief Run the startup tasks and wait for all of them to finish
+ *
+ * The timeline is logged once done and served on /stats/startup.
+ *
+ * @return 0 once all tasks ran, whether they failed or not
+ */
+int startup_run(void);
+
+#endif /* APP_STARTUP_H_ */
@@ -38,6 +38,251 @@ function setNetStat(json_data, stat_name)
 	document.getElementById(stat_name).innerHTML = json_data[stat_name];
 }
 
+function showNetStats(data)
+{
+	setNetStat(data, "bytes_recv");
+	setNetStat(data, "bytes_sent");
+	setNetStat(data, "ipv6_pkt_recv");
+	setNetStat(data, "ipv6_pkt_sent");
+	setNetStat(data, "ipv4_pkt_recv");
+	setNetStat(data, "ipv4_pkt_sent");
+	setNetStat(data, "tcp_bytes_recv");
+	setNetStat(data, "tcp_bytes_sent");
+}
+
+/* The compressed stream is one raw DEFLATE stream across all messages, each
+ * message being a newline terminated JSON object.
+ */
+function connectNetStatsDeflate()
+{
+	const ws = new WebSocket("/netstats.deflate");
+	const inflate = new DecompressionStream("deflate-raw");
+	const writer = inflate.writable.getWriter();
+	const reader = inflate.readable.pipeThrough(new TextDecoderStream()).getReader();
+	let pending = "";
+
+	ws.binaryType = "arraybuffer";
+	ws.onmessage = (event) => {
+		writer.write(new Uint8Array(event.data));
+	}
+	ws.onerror = () => {
+		connectNetStats();
+	}
+
+	(async () => {
+		while (true) {
+			const {value, done} = await reader.read();
+			if (done) {
+				break;
+			}
+
+			pending += value;
+			const lines = pending.split("\n");
+			pending = lines.pop();
+			for (const line of lines) {
+				showNetStats(JSON.parse(line));
+			}
+		}
+	})();
+}
+
+function connectNetStats()
+{
+	const ws = new WebSocket("/");
+
+	ws.onmessage = (event) => {
+		showNetStats(JSON.parse(event.data));
+	}
+}
+
+/* Sensor batches are binary, see sensor_stream.h for the layout */
+function connectSensor()
+{
+	const ws = new WebSocket("/sensor");
+	let received = 0;
+
+	ws.binaryType = "arraybuffer";
+	ws.onmessage = (event) => {
+		const view = new DataView(event.data);
+		const count = view.getUint16(0, true);
+		let offset = 2;
+		let last = null;
+
+		for (let i = 0; i < count; i++) {
+			const len = view.getUint8(offset + 5);
+
+			last = {
+				timestamp: view.getUint32(offset, true),
+				data: new Uint8Array(event.data, offset + 6, len),
+			};
+			offset += 6 + len;
+		}
+
+		received += count;
+		document.getElementById("sensor_samples").innerHTML = received;
+		if (last) {
+			document.getElementById("sensor_timestamp").innerHTML = last.timestamp;
+			document.getElementById("sensor_data").innerHTML = Array.from(last.data,
+				(b) => b.toString(16).padStart(2, "0")).join(" ");
+		}
+	}
+}
+
+/* ADC blocks are binary, see adc_stream.h for the layout */
+function connectAdc()
+{
+	const ws = new WebSocket("/adc");
+	let lost = 0;
+	let last_seq = null;
+
+	ws.binaryType = "arraybuffer";
+	ws.onmessage = (event) => {
+		const view = new DataView(event.data);
+		const seq = view.getUint32(0, true);
+		const channels = view.getUint16(12, true);
+		const frames = view.getUint16(14, true);
+		const latest = [];
+
+		if (last_seq !== null) {
+			lost += seq - last_seq - 1;
+		}
+		last_seq = seq;
+
+		for (let c = 0; c < channels; c++) {
+			latest.push(view.getInt16(16 + ((frames - 1) * channels + c) * 2, true));
+		}
+
+		document.getElementById("adc_rate").innerHTML = view.getUint32(8, true);
+		document.getElementById("adc_latest").innerHTML = latest.join(" ");
+		document.getElementById("adc_lost").innerHTML = lost;
+	}
+}
+
+function connectButton()
+{
+	const ws = new WebSocket("/button");
+	let presses = 0;
+
+	ws.onmessage = (event) => {
+		for (const key of JSON.parse(event.data).events) {
+			if (key.value) {
+				presses++;
+			}
+
+			document.getElementById("button_state").innerHTML =
+				key.value ? "pressed" : "released";
+		}
+
+		document.getElementById("button_presses").innerHTML = presses;
+	}
+}
+
+/* Shell output is binary and may split characters, see ws_shell.h */
+function connectShell()
+{
+	const ws = new WebSocket("/shell");
+	const output = document.getElementById("shell_output");
+	const input = document.getElementById("shell_input");
+	const decoder = new TextDecoder();
+
+	ws.binaryType = "arraybuffer";
+	ws.onopen = () => {
+		/* Get a first prompt */
+		ws.send("\r");
+	}
+	ws.onmessage = (event) => {
+		/* Drop the terminal control sequences */
+		const text = decoder.decode(event.data, {stream: true})
+			.replace(/\x1b\[[0-9;]*[A-Za-z]/g, "")
+			.replace(/\r/g, "");
+
+		output.textContent = (output.textContent + text).slice(-4096);
+		output.scrollTop = output.scrollHeight;
+	}
+
+	input.addEventListener("keydown", (event) => {
+		if (event.key === "Enter") {
+			ws.send(input.value + "\r");
+			input.value = "";
+		}
+	})
+}
+
+/* Send the image in numbered chunks, keeping as many in flight as the
+ * device allows and advancing the progress bar on every acknowledgement.
+ */
+function uploadFirmware(file)
+{
+	const progress = document.getElementById("fw_progress");
+	const status = document.getElementById("fw_status");
+	const ws = new WebSocket("/upload_ws");
+	let data = null;
+	let window_size = 0;
+	let chunk_size = 0;
+	let next_seq = 0;
+	let chunks = 0;
+
+	function sendChunks(acked)
+	{
+		while (next_seq < chunks && next_seq - acked < window_size) {
+			const start = next_seq * chunk_size;
+			const chunk = data.subarray(start, start + chunk_size);
+			const msg = new Uint8Array(5 + chunk.length);
+			const view = new DataView(msg.buffer);
+
+			msg[0] = "D".charCodeAt(0);
+			view.setUint32(1, next_seq, true);
+			msg.set(chunk, 5);
+			ws.send(msg);
+			next_seq++;
+		}
+
+		if (next_seq == chunks && acked == chunks) {
+			ws.send(new Uint8Array(["E".charCodeAt(0)]));
+		}
+	}
+
+	ws.binaryType = "arraybuffer";
+	ws.onopen = async () => {
+		data = new Uint8Array(await file.arrayBuffer());
+		progress.max = data.length;
+		progress.value = 0;
+
+		const msg = new Uint8Array(5);
+		msg[0] = "S".charCodeAt(0);
+		new DataView(msg.buffer).setUint32(1, data.length, true);
+		ws.send(msg);
+	}
+	ws.onmessage = (event) => {
+		const view = new DataView(event.data);
+
+		switch (String.fromCharCode(view.getUint8(0))) {
+		case "R":
+			window_size = view.getUint16(1, true);
+			chunk_size = view.getUint16(3, true);
+			chunks = Math.ceil(data.length / chunk_size);
+			sendChunks(0);
+			break;
+		case "A":
+			progress.value = view.getUint32(5, true);
+			sendChunks(view.getUint32(1, true) + 1);
+			break;
+		case "F":
+			const err = view.getInt32(1, true);
+			const written = view.getUint32(5, true);
+			const ms = view.getUint32(9, true);
+
+			status.innerHTML = err == 0 ?
+				`${written} bytes in ${ms} ms, reboot to test the image` :
+				`Upload failed (${err}) after ${written} bytes`;
+			ws.close();
+			break;
+		}
+	}
+	ws.onerror = () => {
+		status.innerHTML = "Upload connection failed";
+	}
+}
 window.addEventListener("DOMContentLoaded", (ev) => {
 	/* Fetch the uptime once per second */
 	setInterval(fetchUptime, 1000);
@@ -55,18 +300,25 @@ window.addEventListener("DOMContentLoaded", (ev) => {
 		postLed(false);
 	})
 
-	/* Setup websocket for handling network stats */
-	const ws = new WebSocket("/");
+	connectSensor();
+	connectButton();
+	connectAdc();
+	connectShell();
 
-	ws.onmessage = (event) => {
-		const data = JSON.parse(event.data);
-		setNetStat(data, "bytes_recv");
-		setNetStat(data, "bytes_sent");
-		setNetStat(data, "ipv6_pkt_recv");
-		setNetStat(data, "ipv6_pkt_sent");
-		setNetStat(data, "ipv4_pkt_recv");
-		setNetStat(data, "ipv4_pkt_sent");
-		setNetStat(data, "tcp_bytes_recv");
-		setNetStat(data, "tcp_bytes_sent");
+	const fw_upload_btn = document.getElementById("fw_upload");
+	fw_upload_btn.addEventListener("click", (event) => {
+		const file = document.getElementById("fw_file").files[0];
+		if (file) {
+			uploadFirmware(file);
+		}
+	})
+
+	/* Setup websocket for handling network stats, compressed if the
+	 * browser can inflate it
+	 */
+	if ("DecompressionStream" in window) {
+		connectNetStatsDeflate();
+	} else {
+		connectNetStats();
 	}
 })
@@ -5,9 +5,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include <zephyr/posix/sys/socket.h>
 #include <zephyr/posix/poll.h>
+#include <zephyr/posix/sys/eventfd.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/net/http/server.h>
@@ -17,7 +19,18 @@
 #include <zephyr/net/websocket.h>
 #include <zephyr/net/net_mgmt.h>
 #include <zephyr/net/net_stats.h>
-#include <zephyr/init.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/slist.h>
+
+#include "deflate.h"
+#include "placement.h"
+#include "adc_stream.h"
+#include "button_push.h"
+#include "route.h"
+#include "sensor_stream.h"
+#include "serial_bridge.h"
+#include "startup.h"
+#include "ws.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
@@ -44,58 +57,285 @@ extern struct k_mem_domain app_domain;
 #define MAX_CLIENT_QUEUE CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS
 #define RECV_BUFFER_SIZE 1280
 
-struct ws_netstats_ctx {
-	int sock;
-	struct k_work_delayable work;
+enum ws_session_type {
+	WS_SESSION_ECHO,
+	WS_SESSION_NETSTATS,
 };
 
-K_THREAD_STACK_ARRAY_DEFINE(ws_handler_stack,
-			    CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS,
-			    STACK_SIZE);
-static struct k_thread ws_handler_thread[CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS];
-static APP_BMEM bool ws_handler_in_use[CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS];
+struct ws_echo_worker;
+
+#define WS_TXQ_MSG_MAX DEFLATE_MAX_INPUT
 
-static struct ws_netstats_ctx netstats_ctx[CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS];
+/* Bounded per session queue of telemetry messages waiting for the socket to
+ * become writable. When it is full the oldest message is dropped, as only
+ * the latest readings matter to a subscriber.
+ */
+struct ws_txq {
+	uint16_t len[CONFIG_NET_SAMPLE_WEBSOCKET_TX_QUEUE_DEPTH];
+	/* Index in ws_topics and capture time of the data, see ws_topic */
+	uint8_t topic[CONFIG_NET_SAMPLE_WEBSOCKET_TX_QUEUE_DEPTH];
+	uint32_t stamp[CONFIG_NET_SAMPLE_WEBSOCKET_TX_QUEUE_DEPTH];
+	char msg[CONFIG_NET_SAMPLE_WEBSOCKET_TX_QUEUE_DEPTH][WS_TXQ_MSG_MAX];
+	uint8_t head;
+	uint8_t count;
+};
 
-static struct data {
+/* Sessions of both kinds are drawn from one slab, so the configured budget
+ * is shared between echo and netstats connections depending on demand.
+ */
+struct ws_session {
 	int sock;
-	uint32_t counter;
-	uint32_t bytes_received;
+	enum ws_session_type type;
+	/* Keepalive state, times are k_uptime_get() values */
+	int64_t last_rx;
+	int64_t ping_sent;
+	bool ping_pending;
+	union {
+		struct {
+			struct ws_echo_worker *worker;
+			int64_t last_data;
+			uint32_t counter;
+			uint32_t bytes_received;
+			/* Echo message by message rather than as a byte stream */
+			bool message_mode;
+			/* A message is being forwarded, next fragments continue it */
+			bool in_message;
+		} echo;
+		struct {
+			/* WS_TOPIC_* bits this session is pushed */
+			uint32_t topics;
+			/* Error of a send made outside netstats_service() */
+			int error;
+			struct deflate_ctx *deflate;
+			struct ws_txq txq;
+		} netstats;
+	};
+	sys_snode_t attach_node;
+};
+
+/* Echo sessions need a thread, which are pooled separately as their stacks
+ * cannot come from the session slab.
+ */
+struct ws_echo_worker {
+	sys_snode_t node;
+	struct k_thread thread;
+	k_thread_stack_t *stack;
+	bool started;
 	struct pollfd fds[1];
 	char recv_buffer[RECV_BUFFER_SIZE];
-} config[CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS] = {
-	[0 ... (CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS - 1)] = {
-		.sock = -1,
-		.fds[0].fd = -1,
-	}
 };
 
-static int get_free_echo_slot(struct data *cfg)
+APP_CCM_MEM_SLAB_DEFINE_STATIC(ws_session_slab, sizeof(struct ws_session),
+			       CONFIG_NET_SAMPLE_WEBSOCKET_SESSIONS, sizeof(void *));
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+/* Compressor state is large (window plus hash table), so it is only taken
+ * by sessions on a resource that asked for compression.
+ */
+APP_CCM_MEM_SLAB_DEFINE_STATIC(ws_deflate_slab, sizeof(struct deflate_ctx),
+			       CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE_SESSIONS, sizeof(void *));
+
+static atomic_t ws_deflate_bytes_in;
+static atomic_t ws_deflate_bytes_out;
+static atomic_t ws_deflate_cycles;
+#endif
+
+APP_CCM_STACK_ARRAY_DEFINE(ws_handler_stack,
+			   CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS,
+			   STACK_SIZE);
+static struct ws_echo_worker APP_CCM_BSS ws_echo_workers[CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS];
+static sys_slist_t ws_echo_worker_free = SYS_SLIST_STATIC_INIT(&ws_echo_worker_free);
+static struct k_spinlock ws_echo_worker_lock;
+
+static atomic_t ws_sessions_current;
+static atomic_t ws_sessions_peak;
+static atomic_t ws_sessions_echo;
+static atomic_t ws_sessions_netstats;
+static atomic_t ws_sessions_rejected;
+static atomic_t ws_sessions_reaped;
+static atomic_t ws_sessions_idle_closed;
+static atomic_t ws_sessions_stalled;
+static atomic_t ws_tx_dropped;
+
+static struct ws_session *ws_session_alloc(int sock, enum ws_session_type type)
 {
-	for (int i = 0; i < CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS; i++) {
-		if (cfg[i].sock < 0) {
-			return i;
+	struct ws_session *session;
+	atomic_val_t cur;
+	atomic_val_t peak;
+
+	if (k_mem_slab_alloc(&ws_session_slab, (void **)&session, K_NO_WAIT) < 0) {
+		atomic_inc(&ws_sessions_rejected);
+		return NULL;
+	}
+
+	memset(session, 0, sizeof(*session));
+	session->sock = sock;
+	session->type = type;
+	session->last_rx = k_uptime_get();
+
+	atomic_inc(type == WS_SESSION_ECHO ? &ws_sessions_echo : &ws_sessions_netstats);
+	cur = atomic_inc(&ws_sessions_current) + 1;
+	do {
+		peak = atomic_get(&ws_sessions_peak);
+	} while (cur > peak && !atomic_cas(&ws_sessions_peak, peak, cur));
+
+	return session;
+}
+
+static void ws_session_free(struct ws_session *session)
+{
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+	if (session->type == WS_SESSION_NETSTATS && session->netstats.deflate != NULL) {
+		k_mem_slab_free(&ws_deflate_slab, session->netstats.deflate);
+	}
+#endif
+
+	atomic_dec(session->type == WS_SESSION_ECHO ? &ws_sessions_echo : &ws_sessions_netstats);
+	atomic_dec(&ws_sessions_current);
+
+	k_mem_slab_free(&ws_session_slab, session);
+}
+
+static struct ws_echo_worker *ws_echo_worker_get(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&ws_echo_worker_lock);
+	sys_snode_t *node = sys_slist_get(&ws_echo_worker_free);
+
+	k_spin_unlock(&ws_echo_worker_lock, key);
+
+	return node == NULL ? NULL : CONTAINER_OF(node, struct ws_echo_worker, node);
+}
+
+static void ws_echo_worker_put(struct ws_echo_worker *worker)
+{
+	k_spinlock_key_t key = k_spin_lock(&ws_echo_worker_lock);
+
+	sys_slist_prepend(&ws_echo_worker_free, &worker->node);
+	k_spin_unlock(&ws_echo_worker_lock, key);
+}
+
+/* Wait until the socket can take more data. Returns -EAGAIN if it cannot
+ * within timeout milliseconds, so callers never block on a slow peer for
+ * longer than they chose to.
+ */
+static int ws_wait_writable(int sock, int timeout)
+{
+	struct pollfd pfd = {
+		.fd = sock,
+		.events = POLLOUT,
+	};
+	int ret;
+
+	ret = poll(&pfd, 1, timeout);
+	if (ret < 0) {
+		return -errno;
+	} else if (ret == 0) {
+		return -EAGAIN;
+	}
+
+	if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+		return -ENOTCONN;
+	}
+
+	return 0;
+}
+
+/* Account a frame received from the client, answering pings. Fails if a
+ * pong was left half sent.
+ */
+static int ws_keepalive_rx(struct ws_session *session, uint32_t message_type,
+			   const uint8_t *payload, size_t len)
+{
+	int ret;
+
+	session->last_rx = k_uptime_get();
+
+	if (message_type & WEBSOCKET_FLAG_PONG) {
+		session->ping_pending = false;
+	}
+
+	if ((message_type & WEBSOCKET_FLAG_PING) && ws_wait_writable(session->sock, 0) == 0) {
+		ret = websocket_send_msg(session->sock, payload, len, WEBSOCKET_OPCODE_PONG, false,
+					 true, CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+		if (ret < 0) {
+			return ret;
 		}
 	}
 
-	return -1;
+	return 0;
 }
 
-static int get_free_netstats_slot(void)
+/* Send a ping once the client has been silent for a ping interval and
+ * return -ETIMEDOUT when the pong did not arrive in time.
+ */
+static int ws_keepalive_check(struct ws_session *session)
 {
-	for (int i = 0; i < CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS; i++) {
-		if (netstats_ctx[i].sock < 0) {
-			return i;
+	int64_t now = k_uptime_get();
+	uint32_t stamp;
+	int ret;
+
+	if (session->ping_pending) {
+		if (now - session->ping_sent >= CONFIG_NET_SAMPLE_WEBSOCKET_PONG_TIMEOUT) {
+			atomic_inc(&ws_sessions_reaped);
+			return -ETIMEDOUT;
+		}
+
+		return 0;
+	}
+
+	if (CONFIG_NET_SAMPLE_WEBSOCKET_PING_INTERVAL == 0 ||
+	    now - session->last_rx < CONFIG_NET_SAMPLE_WEBSOCKET_PING_INTERVAL) {
+		return 0;
+	}
+
+	/* A peer that cannot even take a ping is handled as one that does not
+	 * answer it.
+	 */
+	if (ws_wait_writable(session->sock, 0) == 0) {
+		stamp = (uint32_t)now;
+		ret = websocket_send_msg(session->sock, (const uint8_t *)&stamp, sizeof(stamp),
+					 WEBSOCKET_OPCODE_PING, false, true,
+					 CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+		if (ret < 0) {
+			atomic_inc(&ws_sessions_reaped);
+			return -ETIMEDOUT;
 		}
 	}
 
-	return -1;
+	session->ping_sent = now;
+	session->ping_pending = true;
+
+	return 0;
+}
+
+/* Milliseconds until ws_keepalive_check() has something to do, -1 if never */
+static int ws_keepalive_timeout(const struct ws_session *session)
+{
+	int64_t deadline;
+
+	if (session->ping_pending) {
+		deadline = session->ping_sent + CONFIG_NET_SAMPLE_WEBSOCKET_PONG_TIMEOUT;
+	} else if (CONFIG_NET_SAMPLE_WEBSOCKET_PING_INTERVAL > 0) {
+		deadline = session->last_rx + CONFIG_NET_SAMPLE_WEBSOCKET_PING_INTERVAL;
+	} else {
+		return -1;
+	}
+
+	return MAX(deadline - k_uptime_get(), 0);
 }
 
 static ssize_t sendall(int sock, const void *buf, size_t len)
 {
 	while (len) {
-		ssize_t out_len = send(sock, buf, len, 0);
+		ssize_t out_len;
+		int ret;
+
+		ret = ws_wait_writable(sock, CONFIG_NET_SAMPLE_WEBSOCKET_STALL_TIMEOUT);
+		if (ret < 0) {
+			return ret;
+		}
+
+		out_len = send(sock, buf, len, 0);
 
 		if (out_len < 0) {
 			return out_len;
@@ -107,71 +347,172 @@ static ssize_t sendall(int sock, const void *buf, size_t len)
 	return 0;
 }
 
+/* Forward one received piece of a message as a frame of its own, so that a
+ * large fragmented message streams through the receive buffer. The reply
+ * keeps the message opcode and ends where the received message ends.
+ */
+static int ws_echo_forward(struct ws_session *session, uint32_t message_type,
+			   uint64_t remaining, const uint8_t *buf, size_t len)
+{
+	bool final = (message_type & WEBSOCKET_FLAG_FINAL) && remaining == 0;
+	enum websocket_opcode opcode;
+	int ret;
+
+	if (session->echo.in_message) {
+		opcode = WEBSOCKET_OPCODE_CONTINUE;
+	} else if (message_type & WEBSOCKET_FLAG_TEXT) {
+		opcode = WEBSOCKET_OPCODE_DATA_TEXT;
+	} else {
+		opcode = WEBSOCKET_OPCODE_DATA_BINARY;
+	}
+
+	ret = ws_wait_writable(session->sock, CONFIG_NET_SAMPLE_WEBSOCKET_STALL_TIMEOUT);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = websocket_send_msg(session->sock, buf, len, opcode, false, final,
+				 CONFIG_NET_SAMPLE_WEBSOCKET_STALL_TIMEOUT);
+	if (ret < 0) {
+		return ret;
+	}
+
+	session->echo.in_message = !final;
+
+	return 0;
+}
+
 static void ws_echo_handler(void *ptr1, void *ptr2, void *ptr3)
 {
-	int slot = POINTER_TO_INT(ptr1);
-	struct data *cfg = ptr2;
-	bool *in_use = ptr3;
+	struct ws_session *session = ptr1;
+	struct ws_echo_worker *worker = ptr2;
+	int slot = POINTER_TO_INT(ptr3);
+	uint32_t message_type;
+	uint64_t remaining;
+	int64_t idle;
+	int timeout;
 	int offset = 0;
 	int received;
 	int client;
 	int ret;
 
-	client = cfg->sock;
+	client = session->sock;
+	session->echo.last_data = k_uptime_get();
 
-	cfg->fds[0].fd = client;
-	cfg->fds[0].events = POLLIN;
+	worker->fds[0].fd = client;
+	worker->fds[0].events = POLLIN;
 
 	/* In this example, we start to receive data from the websocket
-	 * and send it back to the client. Note that we could either use
-	 * the BSD socket interface if we do not care about Websocket
-	 * specific packets, or we could use the websocket_{send/recv}_msg()
-	 * function to send websocket specific data.
+	 * and send it back to the client. Messages are read with
+	 * websocket_recv_msg() so that control frames (ping, pong, close)
+	 * are told apart from data, which is echoed back through the BSD
+	 * socket interface.
 	 */
 	while (true) {
-		if (poll(cfg->fds, 1, -1) < 0) {
+		timeout = ws_keepalive_timeout(session);
+
+		if (CONFIG_NET_SAMPLE_WEBSOCKET_IDLE_TIMEOUT > 0) {
+			idle = session->echo.last_data + CONFIG_NET_SAMPLE_WEBSOCKET_IDLE_TIMEOUT -
+			       k_uptime_get();
+			if (idle <= 0) {
+				LOG_INF("[%d] Idle for too long, closing", slot);
+				atomic_inc(&ws_sessions_idle_closed);
+				break;
+			}
+
+			timeout = (timeout < 0) ? idle : MIN(timeout, idle);
+		}
+
+		ret = poll(worker->fds, 1, timeout);
+		if (ret < 0) {
 			LOG_ERR("Error in poll:%d", errno);
 			continue;
 		}
 
-		if (cfg->fds[0].fd < 0) {
+		if (ret == 0) {
+			if (ws_keepalive_check(session) < 0) {
+				LOG_INF("[%d] No pong from client, closing", slot);
+				break;
+			}
+
+			continue;
+		}
+
+		if (worker->fds[0].fd < 0) {
 			continue;
 		}
 
-		if (cfg->fds[0].revents & ZSOCK_POLLHUP) {
+		if (worker->fds[0].revents & ZSOCK_POLLHUP) {
 			LOG_DBG("Client #%d has disconnected", client);
 			break;
 		}
 
-		received = recv(client,
-				cfg->recv_buffer + offset,
-				sizeof(cfg->recv_buffer) - offset,
-				0);
+		received = websocket_recv_msg(client,
+					      (uint8_t *)worker->recv_buffer + offset,
+					      sizeof(worker->recv_buffer) - offset,
+					      &message_type, &remaining, 0);
+		if (received == -EAGAIN) {
+			continue;
+		} else if (received < 0) {
+			/* Socket error */
+			LOG_ERR("[%d] Connection error %d", slot, received);
+			break;
+		}
 
-		if (received == 0) {
+		ret = ws_keepalive_rx(session, message_type,
+				      (const uint8_t *)worker->recv_buffer + offset, received);
+		if (ret < 0) {
+			LOG_ERR("[%d] Failed to send pong (%d), closing socket", slot, ret);
+			break;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_CLOSE) {
 			/* Connection closed */
 			LOG_INF("[%d] Connection closed", slot);
 			break;
-		} else if (received < 0) {
-			/* Socket error */
-			LOG_ERR("[%d] Connection error %d", slot, errno);
-			break;
 		}
 
-		cfg->bytes_received += received;
+		if (message_type & (WEBSOCKET_FLAG_PING | WEBSOCKET_FLAG_PONG)) {
+			continue;
+		}
+
+		session->echo.last_data = session->last_rx;
+		session->echo.bytes_received += received;
+
+		if (session->echo.message_mode) {
+			ret = ws_echo_forward(session, message_type, remaining,
+					      (const uint8_t *)worker->recv_buffer, received);
+			if (ret == -EAGAIN) {
+				/* Echo replies cannot be dropped, disconnect instead */
+				LOG_INF("[%d] Client does not read its replies, closing", slot);
+				atomic_inc(&ws_sessions_stalled);
+				break;
+			} else if (ret < 0) {
+				LOG_ERR("[%d] Failed to send data (%d), closing socket",
+					slot, ret);
+				break;
+			}
+
+			if (!session->echo.in_message &&
+			    ++session->echo.counter % 1000 == 0U) {
+				LOG_INF("[%d] Echoed %u messages", slot, session->echo.counter);
+			}
+
+			continue;
+		}
+
 		offset += received;
 
 		/* To prevent fragmentation of the response, reply only if
-		 * buffer is full or there is no more data to read
+		 * buffer is full or the message has been fully received
 		 */
-		if (offset == sizeof(cfg->recv_buffer) ||
-		    (recv(client, cfg->recv_buffer + offset,
-			  sizeof(cfg->recv_buffer) - offset,
-			  MSG_PEEK | MSG_DONTWAIT) < 0 &&
-		     (errno == EAGAIN || errno == EWOULDBLOCK))) {
-
-			ret = sendall(client, cfg->recv_buffer, offset);
-			if (ret < 0) {
+		if (offset == sizeof(worker->recv_buffer) || remaining == 0) {
+			ret = sendall(client, worker->recv_buffer, offset);
+			if (ret == -EAGAIN) {
+				LOG_INF("[%d] Client does not read its replies, closing", slot);
+				atomic_inc(&ws_sessions_stalled);
+				break;
+			} else if (ret < 0) {
 				LOG_ERR("[%d] Failed to send data, closing socket",
 					slot);
 				break;
@@ -180,22 +521,22 @@ static void ws_echo_handler(void *ptr1, void *ptr2, void *ptr3)
 			LOG_DBG("[%d] Received and replied with %d bytes",
 				slot, offset);
 
-			if (++cfg->counter % 1000 == 0U) {
-				LOG_INF("[%d] Sent %u packets", slot, cfg->counter);
+			if (++session->echo.counter % 1000 == 0U) {
+				LOG_INF("[%d] Sent %u packets", slot, session->echo.counter);
 			}
 
 			offset = 0;
 		}
 	}
 
-	*in_use = false;
-
 	(void)websocket_unregister(client);
 
-	cfg->sock = -1;
+	worker->fds[0].fd = -1;
+	ws_session_free(session);
+	ws_echo_worker_put(worker);
 }
 
-static int netstats_collect(char *buf, size_t maxlen)
+static int netstats_collect(char *buf, size_t maxlen, uint32_t *stamp)
 {
 	int ret;
 	struct net_stats data;
@@ -246,91 +587,609 @@ static int netstats_collect(char *buf, size_t maxlen)
 	return ret;
 }
 
-#define WS_NETSTATS_STACK_SIZE 2048
-K_THREAD_STACK_DEFINE(ws_netstats_stack, WS_NETSTATS_STACK_SIZE);
-struct k_work_q ws_netstats_queue;
+int ws_netstats_json(char *buf, size_t maxlen)
+{
+	uint32_t stamp;
+
+	return netstats_collect(buf, maxlen, &stamp);
+}
+
+#define WS_PUSH_STACK_SIZE 2048
+
+/* Internal notification: sessions are waiting on the attach list */
+#define WS_PUSH_ATTACH BIT(31)
+
+/* Producers of pushed messages, each formats its latest data on demand.
+ * A producer that sets the k_cycle_get_32() capture time of its data in
+ * collect() has sent() called with it every time a message went out.
+ *
+ * Producers of large messages lend their own buffer with borrow() instead,
+ * which is sent to every subscriber that can take it right away and handed
+ * back with release(), without passing through the session queues.
+ *
+ * Data messages from subscribers are passed to rx(), if set.
+ */
+struct ws_topic {
+	uint32_t mask;
+	int (*collect)(char *buf, size_t maxlen, uint32_t *stamp);
+	void (*sent)(uint32_t stamp);
+	const uint8_t *(*borrow)(size_t *len);
+	void (*release)(const uint8_t *buf);
+	void (*rx)(const uint8_t *data, size_t len);
+	/* Messages are sent as binary frames, and never compressed */
+	bool binary;
+};
 
-static void netstats_handler(struct k_work *work)
+static const struct ws_topic ws_topics[] = {
+	{
+		.mask = WS_TOPIC_NETSTATS,
+		.collect = netstats_collect,
+	},
+#if defined(CONFIG_NET_SAMPLE_SENSOR_STREAM)
+	{
+		.mask = WS_TOPIC_SENSOR,
+		.collect = sensor_stream_collect,
+		.binary = true,
+	},
+#endif
+#if defined(CONFIG_NET_SAMPLE_BUTTON_PUSH)
+	{
+		.mask = WS_TOPIC_BUTTON,
+		.collect = button_push_collect,
+		.sent = button_push_sent,
+	},
+#endif
+#if defined(CONFIG_NET_SAMPLE_SERIAL_BRIDGE)
+	{
+		.mask = WS_TOPIC_SERIAL,
+		.collect = serial_bridge_collect,
+		.rx = serial_bridge_write,
+		.binary = true,
+	},
+#endif
+#if defined(CONFIG_NET_SAMPLE_ADC_STREAM)
+	{
+		.mask = WS_TOPIC_ADC,
+		.borrow = adc_stream_borrow,
+		.release = adc_stream_release,
+		.binary = true,
+	},
+#endif
+};
+
+static int ws_push_fd = -1;
+static atomic_t ws_push_pending;
+static atomic_t ws_push_stamp;
+static atomic_t ws_push_wakeups;
+static atomic_t ws_push_wake_max_us;
+
+static sys_slist_t ws_push_attach_list = SYS_SLIST_STATIC_INIT(&ws_push_attach_list);
+static struct k_spinlock ws_push_attach_lock;
+
+/* Only used by the push thread */
+static struct ws_session *ws_push_sessions[CONFIG_NET_SAMPLE_WEBSOCKET_SESSIONS];
+static struct pollfd ws_push_fds[CONFIG_NET_SAMPLE_WEBSOCKET_SESSIONS + 1];
+static char APP_CCM_NOINIT ws_push_msg[ARRAY_SIZE(ws_topics)][WS_TXQ_MSG_MAX];
+static int ws_push_msg_len[ARRAY_SIZE(ws_topics)];
+static uint32_t ws_push_msg_stamp[ARRAY_SIZE(ws_topics)];
+
+static void ws_push_kick(void)
 {
+	if (ws_push_fd >= 0) {
+		(void)eventfd_write(ws_push_fd, 1);
+	}
+}
+
+/* The file descriptor table is guarded by a mutex, so interrupts ring the
+ * doorbell through the system work queue.
+ */
+static void ws_push_kick_handler(struct k_work *work)
+{
+	ws_push_kick();
+}
+
+static K_WORK_DEFINE(ws_push_kick_work, ws_push_kick_handler);
+
+void ws_notify(uint32_t topics)
+{
+	/* The push thread consumes all pending bits at once, so only the
+	 * first producer since then needs to wake it.
+	 */
+	if (atomic_or(&ws_push_pending, topics) != 0) {
+		return;
+	}
+
+	atomic_set(&ws_push_stamp, k_cycle_get_32());
+
+	if (k_is_in_isr()) {
+		(void)k_work_submit(&ws_push_kick_work);
+	} else {
+		ws_push_kick();
+	}
+}
+
+static void ws_push_account_wakeup(void)
+{
+	uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - atomic_get(&ws_push_stamp));
+	atomic_val_t max;
+
+	atomic_inc(&ws_push_wakeups);
+	do {
+		max = atomic_get(&ws_push_wake_max_us);
+	} while (us > max && !atomic_cas(&ws_push_wake_max_us, max, us));
+}
+
+static void netstats_session_release(struct ws_session *session)
+{
+	(void)websocket_unregister(session->sock);
+	session->sock = -1;
+	ws_session_free(session);
+}
+
+/* Most push clients only listen, but their pongs and close frames still
+ * have to be read from the socket. Data they send goes to the topics they
+ * subscribed to that take input.
+ */
+static int netstats_drain(struct ws_session *session)
+{
+	static uint8_t rx_buf[64];
+	uint32_t message_type;
+	uint64_t remaining;
 	int ret;
-	static char tx_buf[256];
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct ws_netstats_ctx *ctx = CONTAINER_OF(dwork, struct ws_netstats_ctx, work);
+	int err;
 
-	ret = netstats_collect(tx_buf, sizeof(tx_buf));
+	while (true) {
+		ret = websocket_recv_msg(session->sock, rx_buf, sizeof(rx_buf), &message_type,
+					 &remaining, 0);
+		if (ret == -EAGAIN) {
+			return 0;
+		} else if (ret < 0) {
+			return ret;
+		}
+
+		err = ws_keepalive_rx(session, message_type, rx_buf, ret);
+		if (err < 0) {
+			return err;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_CLOSE) {
+			return -ECONNRESET;
+		}
+
+		if (message_type & (WEBSOCKET_FLAG_PING | WEBSOCKET_FLAG_PONG)) {
+			continue;
+		}
+
+		for (int i = 0; i < ARRAY_SIZE(ws_topics); i++) {
+			if ((session->netstats.topics & ws_topics[i].mask) &&
+			    ws_topics[i].rx != NULL) {
+				ws_topics[i].rx(rx_buf, ret);
+			}
+		}
+	}
+}
+
+/* Return the slot for a new message, dropping the oldest one if needed */
+static char *ws_txq_reserve(struct ws_txq *q)
+{
+	if (q->count == ARRAY_SIZE(q->msg)) {
+		q->head = (q->head + 1) % ARRAY_SIZE(q->msg);
+		q->count--;
+		atomic_inc(&ws_tx_dropped);
+	}
+
+	return q->msg[(q->head + q->count) % ARRAY_SIZE(q->msg)];
+}
+
+static void ws_txq_commit(struct ws_txq *q, size_t len, uint8_t topic, uint32_t stamp)
+{
+	q->len[(q->head + q->count) % ARRAY_SIZE(q->msg)] = len;
+	q->topic[(q->head + q->count) % ARRAY_SIZE(q->msg)] = topic;
+	q->stamp[(q->head + q->count) % ARRAY_SIZE(q->msg)] = stamp;
+	q->count++;
+}
+
+static void ws_txq_pop(struct ws_txq *q)
+{
+	q->head = (q->head + 1) % ARRAY_SIZE(q->msg);
+	q->count--;
+}
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+static int netstats_send_deflate(struct ws_session *session, char *buf, int len, size_t maxlen)
+{
+	static uint8_t z_buf[DEFLATE_BOUND(DEFLATE_MAX_INPUT)];
+	uint32_t start;
+	int ret;
+
+	/* Messages are newline delimited so that the client can split the
+	 * decompressed stream again.
+	 */
+	if (len + 1 > maxlen) {
+		return -ENOSPC;
+	}
+	buf[len++] = '\n';
+
+	start = k_cycle_get_32();
+	ret = deflate_compress(session->netstats.deflate, (const uint8_t *)buf, len, z_buf,
+			       sizeof(z_buf));
+	atomic_add(&ws_deflate_cycles, k_cycle_get_32() - start);
 	if (ret < 0) {
-		LOG_ERR("Unable to collect network statistics, err %d", ret);
-		goto unregister;
+		return ret;
+	}
+
+	atomic_add(&ws_deflate_bytes_in, len);
+	atomic_add(&ws_deflate_bytes_out, ret);
+
+	return websocket_send_msg(session->sock, z_buf, ret, WEBSOCKET_OPCODE_DATA_BINARY, false,
+				  true, CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+}
+#endif
+
+/* Send queued messages for as long as the socket is writable, whatever is
+ * left is retried on the next tick. Writable only means that a frame can
+ * be started: one that does not fit within
+ * CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT fails the session, as the
+ * connection then holds a partial frame.
+ */
+static int netstats_flush(struct ws_session *session)
+{
+	struct ws_txq *q = &session->netstats.txq;
+	const struct ws_topic *topic;
+	enum websocket_opcode opcode;
+	char *msg;
+	int ret;
+
+	while (q->count > 0) {
+		ret = ws_wait_writable(session->sock, 0);
+		if (ret == -EAGAIN) {
+			return 0;
+		} else if (ret < 0) {
+			return ret;
+		}
+
+		msg = q->msg[q->head];
+		topic = &ws_topics[q->topic[q->head]];
+
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+		if (session->netstats.deflate != NULL && !topic->binary) {
+			ret = netstats_send_deflate(session, msg, q->len[q->head], WS_TXQ_MSG_MAX);
+		} else
+#endif
+		{
+			opcode = topic->binary ? WEBSOCKET_OPCODE_DATA_BINARY
+					       : WEBSOCKET_OPCODE_DATA_TEXT;
+			ret = websocket_send_msg(session->sock, msg, q->len[q->head], opcode,
+						 false, true,
+						 CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+		}
+
+		if (ret >= 0 && topic->sent != NULL && q->stamp[q->head] != 0) {
+			topic->sent(q->stamp[q->head]);
+		}
+
+		ws_txq_pop(q);
+
+		if (ret < 0) {
+			return ret;
+		}
 	}
 
-	ret = websocket_send_msg(ctx->sock, tx_buf, ret, WEBSOCKET_OPCODE_DATA_TEXT, false, true,
-				 SYS_FOREVER_MS);
+	return 0;
+}
+
+/* Read control frames, queue the messages of the notified topics and send
+ * as much as the socket takes.
+ */
+static int netstats_service(struct ws_session *session, short revents, uint32_t topics)
+{
+	char *msg;
+	int ret;
+
+	if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+		LOG_INF("Net stats client went away, closing connection");
+		return -ENOTCONN;
+	}
+
+	if (session->netstats.error < 0) {
+		LOG_INF("Couldn't send websocket msg (%d), closing connection",
+			session->netstats.error);
+		return session->netstats.error;
+	}
+
+	if (revents & POLLIN) {
+		ret = netstats_drain(session);
+		if (ret < 0) {
+			LOG_INF("Net stats client went away (%d), closing connection", ret);
+			return ret;
+		}
+	}
+
+	if (ws_keepalive_check(session) < 0) {
+		LOG_INF("No pong from net stats client, closing connection");
+		return -ETIMEDOUT;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(ws_topics); i++) {
+		if (!(topics & session->netstats.topics & ws_topics[i].mask) ||
+		    ws_push_msg_len[i] < 0) {
+			continue;
+		}
+
+		msg = ws_txq_reserve(&session->netstats.txq);
+		memcpy(msg, ws_push_msg[i], ws_push_msg_len[i]);
+		ws_txq_commit(&session->netstats.txq, ws_push_msg_len[i], i,
+			      ws_push_msg_stamp[i]);
+	}
+
+	/* A slow peer holds up the other subscribers for one send timeout at
+	 * most, it is closed when a frame fails to go out
+	 */
+	ret = netstats_flush(session);
 	if (ret < 0) {
 		LOG_INF("Couldn't send websocket msg (%d), closing connection", ret);
-		goto unregister;
+		return ret;
 	}
 
-	ret = k_work_reschedule_for_queue(&ws_netstats_queue, &ctx->work,
-					  K_MSEC(CONFIG_NET_SAMPLE_WEBSOCKET_STATS_INTERVAL));
-	if (ret < 0) {
-		LOG_ERR("Failed to schedule netstats work, err %d", ret);
-		goto unregister;
+	return 0;
+}
+
+/* Send every buffer the borrowing topics have ready. A subscriber that
+ * cannot take a buffer immediately misses it, as the producer needs it
+ * back to keep going. One whose send fails is closed by netstats_service().
+ */
+static void ws_push_borrowed(int count, uint32_t topics)
+{
+	const struct ws_topic *topic;
+	struct ws_session *session;
+	const uint8_t *buf;
+	size_t len;
+	int ret;
+
+	for (int i = 0; i < ARRAY_SIZE(ws_topics); i++) {
+		topic = &ws_topics[i];
+		if (!(topics & topic->mask) || topic->borrow == NULL) {
+			continue;
+		}
+
+		while ((buf = topic->borrow(&len)) != NULL) {
+			for (int j = 0; j < count; j++) {
+				session = ws_push_sessions[j];
+				if (!(session->netstats.topics & topic->mask)) {
+					continue;
+				}
+
+				if (session->netstats.error < 0 ||
+				    ws_wait_writable(session->sock, 0) < 0) {
+					atomic_inc(&ws_tx_dropped);
+					continue;
+				}
+
+				ret = websocket_send_msg(session->sock, buf, len,
+							 WEBSOCKET_OPCODE_DATA_BINARY, false, true,
+							 CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+				if (ret < 0) {
+					/* Part of the frame may be out, nothing else can
+					 * follow it, netstats_service() closes the session
+					 */
+					session->netstats.error = ret;
+					atomic_inc(&ws_tx_dropped);
+				}
+			}
+
+			topic->release(buf);
+		}
 	}
+}
+
+/* Move newly set up sessions into the poll set */
+static int ws_push_attach(int count)
+{
+	k_spinlock_key_t key;
+	sys_snode_t *node;
+
+	while (true) {
+		key = k_spin_lock(&ws_push_attach_lock);
+		node = sys_slist_get(&ws_push_attach_list);
+		k_spin_unlock(&ws_push_attach_lock, key);
+
+		if (node == NULL) {
+			return count;
+		}
+
+		ws_push_sessions[count] = CONTAINER_OF(node, struct ws_session, attach_node);
+		ws_push_fds[count + 1].fd = ws_push_sessions[count]->sock;
+		ws_push_fds[count + 1].revents = 0;
+		count++;
+	}
+}
+
+/* All pushed sessions are served by this one thread. It sleeps in poll()
+ * on their sockets and on an eventfd which producers write to with
+ * ws_notify(), so new data goes out as soon as it exists rather than on
+ * the next timer tick. Net stats are additionally sent every
+ * CONFIG_NET_SAMPLE_WEBSOCKET_STATS_INTERVAL.
+ */
+static void ws_push_thread(void *p1, void *p2, void *p3)
+{
+	int64_t next_tick = k_uptime_get();
+	struct ws_session *session;
+	eventfd_t value;
+	uint32_t topics;
+	int64_t now;
+	int timeout;
+	int count = 0;
+	int ret;
+
+	ws_push_fd = eventfd(0, EFD_NONBLOCK);
+	if (ws_push_fd < 0) {
+		LOG_ERR("Failed to create push eventfd, err %d", errno);
+		return;
+	}
+
+	ws_push_fds[0].fd = ws_push_fd;
+	ws_push_fds[0].events = POLLIN;
+
+	/* Producers may have notified before the eventfd existed */
+	ws_push_kick();
+
+	while (true) {
+		timeout = -1;
+		if (count > 0) {
+			timeout = MAX(next_tick - k_uptime_get(), 0);
+		}
+
+		for (int i = 0; i < count; i++) {
+			ret = ws_keepalive_timeout(ws_push_sessions[i]);
+			if (ret >= 0) {
+				timeout = (timeout < 0) ? ret : MIN(timeout, ret);
+			}
+
+			ws_push_fds[i + 1].events = POLLIN;
+			if (ws_push_sessions[i]->netstats.txq.count > 0) {
+				ws_push_fds[i + 1].events |= POLLOUT;
+			}
+		}
+
+		ret = poll(ws_push_fds, count + 1, timeout);
+		if (ret < 0) {
+			LOG_ERR("Error in poll:%d", errno);
+			continue;
+		}
+
+		topics = 0;
+		if (ws_push_fds[0].revents & POLLIN) {
+			(void)eventfd_read(ws_push_fd, &value);
+			topics = atomic_clear(&ws_push_pending);
+			if (topics != 0) {
+				ws_push_account_wakeup();
+			}
+		}
+
+		if (topics & WS_PUSH_ATTACH) {
+			count = ws_push_attach(count);
+			/* Greet new subscribers with data right away */
+			next_tick = 0;
+		}
+
+		now = k_uptime_get();
+		if (now >= next_tick) {
+			topics |= WS_TOPIC_NETSTATS;
+			next_tick = now + CONFIG_NET_SAMPLE_WEBSOCKET_STATS_INTERVAL;
+		}
+
+		/* Format each notified topic once for all its subscribers */
+		for (int i = 0; i < ARRAY_SIZE(ws_topics); i++) {
+			ws_push_msg_len[i] = -1;
+			ws_push_msg_stamp[i] = 0;
+			if (!(topics & ws_topics[i].mask) || ws_topics[i].collect == NULL) {
+				continue;
+			}
+
+			/* Leave room for the message delimiter of the compressed stream */
+			ws_push_msg_len[i] = ws_topics[i].collect(ws_push_msg[i],
+								  WS_TXQ_MSG_MAX - 1,
+								  &ws_push_msg_stamp[i]);
+			/* -ENODATA: woken for nothing new, which is not an error */
+			if (ws_push_msg_len[i] < 0 && ws_push_msg_len[i] != -ENODATA) {
+				LOG_ERR("Unable to collect topic %x, err %d", ws_topics[i].mask,
+					ws_push_msg_len[i]);
+			}
+		}
+
+		ws_push_borrowed(count, topics);
+
+		for (int i = 0; i < count;) {
+			session = ws_push_sessions[i];
+
+			ret = netstats_service(session, ws_push_fds[i + 1].revents, topics);
+			if (ret < 0) {
+				netstats_session_release(session);
 
-	return;
+				count--;
+				ws_push_sessions[i] = ws_push_sessions[count];
+				ws_push_fds[i + 1] = ws_push_fds[count + 1];
+				continue;
+			}
 
-unregister:
-	(void)websocket_unregister(ctx->sock);
-	ctx->sock = -1;
+			i++;
+		}
+	}
 }
 
-int ws_netstats_init(void)
+APP_CCM_STACK_DEFINE(ws_push_stack, WS_PUSH_STACK_SIZE);
+static struct k_thread ws_push_thread_data;
+
+static int ws_netstats_init(void)
 {
-	struct k_work_queue_config cfg = {.name = "ws_netstats_q"};
+	k_thread_create(&ws_push_thread_data, ws_push_stack, K_KERNEL_STACK_SIZEOF(ws_push_stack),
+			ws_push_thread, NULL, NULL, NULL, THREAD_PRIORITY, 0, K_NO_WAIT);
 
-	k_work_queue_init(&ws_netstats_queue);
-	k_work_queue_start(&ws_netstats_queue, ws_netstats_stack, WS_NETSTATS_STACK_SIZE, 0, &cfg);
+	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+		k_thread_name_set(&ws_push_thread_data, "ws_push");
+	}
 
 	for (int i = 0; i < CONFIG_NET_SAMPLE_NUM_WEBSOCKET_HANDLERS; i++) {
-		netstats_ctx[i].sock = -1;
-		k_work_init_delayable(&netstats_ctx[i].work, netstats_handler);
+		ws_echo_workers[i].stack = ws_handler_stack[i];
+		ws_echo_workers[i].fds[0].fd = -1;
+		ws_echo_worker_put(&ws_echo_workers[i]);
 	}
 
 	return 0;
 }
-SYS_INIT(ws_netstats_init, APPLICATION, 0);
+STARTUP_TASK_DEFINE(ws_push, STARTUP_WS_PUSH, 0, ws_netstats_init);
 
 int ws_echo_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data)
 {
+	const struct ws_resource_config *res_cfg = user_data;
+	struct ws_echo_worker *worker;
+	struct ws_session *session;
 	int slot;
 
-	slot = get_free_echo_slot(config);
-	if (slot < 0) {
+	worker = ws_echo_worker_get();
+	if (worker == NULL) {
 		LOG_ERR("Cannot accept more connections");
 		/* The caller will close the connection in this case */
 		return -ENOENT;
 	}
 
-	config[slot].sock = ws_socket;
+	session = ws_session_alloc(ws_socket, WS_SESSION_ECHO);
+	if (session == NULL) {
+		LOG_ERR("No free websocket session");
+		ws_echo_worker_put(worker);
+		return -ENOENT;
+	}
+
+	slot = ARRAY_INDEX(ws_echo_workers, worker);
+	session->echo.worker = worker;
+	session->echo.message_mode = (res_cfg != NULL && res_cfg->message_mode);
+
+	/* The previous user of this worker put it back on the free list
+	 * right before returning, make sure its thread is really gone.
+	 */
+	if (worker->started) {
+		(void)k_thread_join(&worker->thread, K_FOREVER);
+	}
 
 	LOG_INF("[%d] Accepted a Websocket connection", slot);
 
-	k_thread_create(&ws_handler_thread[slot],
-			ws_handler_stack[slot],
-			K_THREAD_STACK_SIZEOF(ws_handler_stack[slot]),
+	k_thread_create(&worker->thread,
+			worker->stack,
+			K_KERNEL_STACK_SIZEOF(ws_handler_stack[slot]),
 			ws_echo_handler,
-			INT_TO_POINTER(slot), &config[slot], &ws_handler_in_use[slot],
+			session, worker, INT_TO_POINTER(slot),
 			THREAD_PRIORITY,
 			IS_ENABLED(CONFIG_USERSPACE) ? K_USER |
 						       K_INHERIT_PERMS : 0,
 			K_NO_WAIT);
+	worker->started = true;
 
 	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
 #define MAX_NAME_LEN (sizeof("ws[xxxxxxxxxx]"))
 		char name[MAX_NAME_LEN];
 
 		snprintk(name, sizeof(name), "ws[%d]", slot);
-		k_thread_name_set(&ws_handler_thread[slot], name);
+		k_thread_name_set(&worker->thread, name);
 	}
 
 	return 0;
@@ -338,23 +1197,118 @@ int ws_echo_setup(int ws_socket, struct http_request_ctx *request_ctx, void *use
 
 int ws_netstats_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data)
 {
+	const struct ws_resource_config *res_cfg = user_data;
+	struct ws_session *session;
+	k_spinlock_key_t key;
 	int ret;
-	int slot;
 
-	slot = get_free_netstats_slot();
-	if (slot < 0) {
+	session = ws_session_alloc(ws_socket, WS_SESSION_NETSTATS);
+	if (session == NULL) {
 		LOG_ERR("Cannot accept more netstats websocket connections");
 		return -ENOENT;
 	}
 
-	netstats_ctx[slot].sock = ws_socket;
+	if (res_cfg != NULL && res_cfg->deflate) {
+#if defined(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE)
+		ret = k_mem_slab_alloc(&ws_deflate_slab, (void **)&session->netstats.deflate,
+				       K_NO_WAIT);
+		if (ret == 0) {
+			deflate_init(session->netstats.deflate);
+		}
+#else
+		ret = -ENOTSUP;
+#endif
+		if (ret < 0) {
+			LOG_ERR("No compressor available for net stats connection");
+			ws_session_free(session);
+			return -ENOENT;
+		}
+	}
+
+	session->netstats.topics = WS_TOPIC_NETSTATS;
+	if (res_cfg != NULL && res_cfg->topics != 0) {
+		session->netstats.topics = res_cfg->topics;
+	}
+
+	key = k_spin_lock(&ws_push_attach_lock);
+	sys_slist_append(&ws_push_attach_list, &session->attach_node);
+	k_spin_unlock(&ws_push_attach_lock, key);
+
+	ws_notify(WS_PUSH_ATTACH);
 
-	ret = k_work_reschedule_for_queue(&ws_netstats_queue, &netstats_ctx[slot].work, K_NO_WAIT);
+	LOG_INF("Accepted websocket connection for net stats");
+	return 0;
+}
+
+int ws_stats_json(char *buf, size_t maxlen)
+{
+	int ret;
+
+	ret = snprintf(buf, maxlen,
+		       "{"
+		       "\"sessions\":%u,"
+		       "\"peak\":%u,"
+		       "\"max\":%u,"
+		       "\"echo\":%u,"
+		       "\"netstats\":%u,"
+		       "\"rejected\":%u,"
+		       "\"reaped\":%u,"
+		       "\"idle_closed\":%u,"
+		       "\"stalled\":%u,"
+		       "\"tx_dropped\":%u,"
+		       "\"deflate_in\":%u,"
+		       "\"deflate_out\":%u,"
+		       "\"deflate_cycles\":%u,"
+		       "\"push_wakeups\":%u,"
+		       "\"push_wake_max_us\":%u"
+		       "}",
+		       (uint32_t)atomic_get(&ws_sessions_current),
+		       (uint32_t)atomic_get(&ws_sessions_peak),
+		       CONFIG_NET_SAMPLE_WEBSOCKET_SESSIONS,
+		       (uint32_t)atomic_get(&ws_sessions_echo),
+		       (uint32_t)atomic_get(&ws_sessions_netstats),
+		       (uint32_t)atomic_get(&ws_sessions_rejected),
+		       (uint32_t)atomic_get(&ws_sessions_reaped),
+		       (uint32_t)atomic_get(&ws_sessions_idle_closed),
+		       (uint32_t)atomic_get(&ws_sessions_stalled),
+		       (uint32_t)atomic_get(&ws_tx_dropped),
+		       (uint32_t)COND_CODE_1(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE,
+					     (atomic_get(&ws_deflate_bytes_in)), (0)),
+		       (uint32_t)COND_CODE_1(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE,
+					     (atomic_get(&ws_deflate_bytes_out)), (0)),
+		       (uint32_t)COND_CODE_1(CONFIG_NET_SAMPLE_WEBSOCKET_DEFLATE,
+					     (atomic_get(&ws_deflate_cycles)), (0)),
+		       (uint32_t)atomic_get(&ws_push_wakeups),
+		       (uint32_t)atomic_get(&ws_push_wake_max_us));
+	if (ret >= maxlen) {
+		return -ENOSPC;
+	}
+
+	return ret;
+}
+
+static int ws_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+			    const struct http_request_ctx *request_ctx,
+			    struct http_response_ctx *response_ctx,
+			    const struct route_params *params)
+{
+	static char json_buf[448];
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = ws_stats_json(json_buf, sizeof(json_buf));
 	if (ret < 0) {
-		LOG_ERR("Failed to schedule netstats work, err %d", ret);
 		return ret;
 	}
 
-	LOG_INF("Accepted websocket connection for net stats");
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = true;
+
 	return 0;
 }
+
+ROUTE_DEFINE(ws_stats_route, "/stats/ws", BIT(HTTP_GET), ws_stats_handler);
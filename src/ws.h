@@ -4,26 +4,79 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
 #include <zephyr/net/http/server.h>
 
+/** Per resource websocket options, passed as resource user data */
+struct ws_resource_config {
+	/** Send messages as newline delimited raw DEFLATE stream */
+	bool deflate;
+	/** Echo whole messages, keeping their opcode, instead of a byte stream */
+	bool message_mode;
+	/** WS_TOPIC_* bits pushed to the client, net stats if 0 */
+	uint32_t topics;
+};
+
 /**
  * @brief Setup websocket for echoing data back to client
  *
  * @param ws_socket Socket file descriptor associated with websocket
  * @param request_ctx Request context associated with websocket HTTP upgrade request
- * @param user_data User data pointer
+ * @param user_data Optional struct ws_resource_config
  *
  * @return 0 on success
  */
 int ws_echo_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data);
 
 /**
- * @brief Setup websocket for sending net statistics to client
+ * @brief Setup websocket for pushing net statistics or other topics to client
  *
  * @param ws_socket Socket file descriptor associated with websocket
  * @param request_ctx Request context associated with websocket HTTP upgrade request
- * @param user_data User data pointer
+ * @param user_data Optional struct ws_resource_config
  *
  * @return 0 on success
  */
 int ws_netstats_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data);
+
+/** Push topics, see ws_notify() */
+#define WS_TOPIC_NETSTATS BIT(0)
+#define WS_TOPIC_SENSOR   BIT(1)
+#define WS_TOPIC_BUTTON   BIT(2)
+#define WS_TOPIC_ADC      BIT(3)
+#define WS_TOPIC_SERIAL   BIT(4)
+
+/**
+ * @brief Wake the websocket push thread
+ *
+ * Subscribers of the given topics are sent fresh data right away instead
+ * of on the next periodic update. Notifications that arrive before the
+ * thread got to run are merged. Can be called from any thread or ISR.
+ *
+ * @param topics WS_TOPIC_* bits of the topics that have new data
+ */
+void ws_notify(uint32_t topics);
+
+/**
+ * @brief Format the net stats pushed to websocket clients as JSON
+ *
+ * @param buf Output buffer
+ * @param maxlen Size of the output buffer
+ *
+ * @return Length of the JSON string on success, negative errno otherwise
+ */
+int ws_netstats_json(char *buf, size_t maxlen);
+
+/**
+ * @brief Format the websocket session pool counters as JSON
+ *
+ * @param buf Output buffer
+ * @param maxlen Size of the output buffer
+ *
+ * @return Length of the JSON string on success, negative errno otherwise
+ */
+int ws_stats_json(char *buf, size_t maxlen);
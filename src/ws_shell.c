@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/posix/poll.h>
+#include <zephyr/posix/sys/eventfd.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/server.h>
+#include <zephyr/net/websocket.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/sys/util.h>
+
+#include "http_auth.h"
+#include "placement.h"
+#include "route.h"
+#include "startup.h"
+#include "ws_shell.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http_server_sample, LOG_LEVEL_DBG);
+
+#define WS_SHELL_STACK_SIZE 2048
+#define WS_SHELL_RX_CHUNK   64
+
+/* Log messages are not routed to websocket shells */
+#define WS_SHELL_LOG_QUEUE_SIZE 128
+#define WS_SHELL_LOG_TIMEOUT    100
+
+#if defined(CONFIG_NET_TC_THREAD_COOPERATIVE)
+#define THREAD_PRIORITY K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1)
+#else
+#define THREAD_PRIORITY K_PRIO_PREEMPT(8)
+#endif
+
+struct ws_shell_ctx {
+	/* Websocket of the client, -1 while the instance is free */
+	int sock;
+	atomic_t busy;
+	shell_transport_handler_t handler;
+	void *handler_ctx;
+	/* Filled by the websocket thread, read by the shell thread */
+	struct ring_buf rx_ring;
+	uint8_t rx_buf[CONFIG_NET_SAMPLE_WS_SHELL_RX_RING];
+	/* Output is gathered here and leaves as one message when it is full
+	 * or CONFIG_NET_SAMPLE_WS_SHELL_FLUSH_MS after its first byte.
+	 */
+	struct k_spinlock tx_lock;
+	uint8_t tx_buf[CONFIG_NET_SAMPLE_WS_SHELL_TX_BUF];
+	size_t tx_len;
+	int64_t tx_deadline;
+	/* The shell waits for room in tx_buf */
+	bool tx_full;
+};
+
+static int ws_shell_fd = -1;
+
+static atomic_t ws_shell_sessions;
+static atomic_t ws_shell_rejected;
+static atomic_t ws_shell_rx_bytes;
+static atomic_t ws_shell_rx_dropped;
+static atomic_t ws_shell_tx_bytes;
+static atomic_t ws_shell_tx_frames;
+
+static void ws_shell_kick(void)
+{
+	if (ws_shell_fd >= 0) {
+		(void)eventfd_write(ws_shell_fd, 1);
+	}
+}
+
+static int ws_shell_transport_init(const struct shell_transport *transport, const void *config,
+				   shell_transport_handler_t evt_handler, void *context)
+{
+	struct ws_shell_ctx *ctx = transport->ctx;
+
+	ctx->handler = evt_handler;
+	ctx->handler_ctx = context;
+	ring_buf_init(&ctx->rx_ring, sizeof(ctx->rx_buf), ctx->rx_buf);
+
+	return 0;
+}
+
+static int ws_shell_transport_uninit(const struct shell_transport *transport)
+{
+	return 0;
+}
+
+static int ws_shell_transport_enable(const struct shell_transport *transport, bool blocking_tx)
+{
+	return 0;
+}
+
+/* Runs in the shell thread, possibly for every single echoed character, so
+ * it only copies into tx_buf. The websocket thread is woken once per
+ * message, when the first byte arrives or the buffer fills up.
+ */
+static int ws_shell_transport_write(const struct shell_transport *transport, const void *data,
+				    size_t length, size_t *cnt)
+{
+	struct ws_shell_ctx *ctx = transport->ctx;
+	k_spinlock_key_t key;
+	bool kick = false;
+
+	/* Nobody is listening, output is dropped rather than held */
+	if (ctx->sock < 0) {
+		*cnt = length;
+		return 0;
+	}
+
+	key = k_spin_lock(&ctx->tx_lock);
+
+	*cnt = MIN(length, sizeof(ctx->tx_buf) - ctx->tx_len);
+	if (ctx->tx_len == 0 && *cnt > 0) {
+		ctx->tx_deadline = k_uptime_get() + CONFIG_NET_SAMPLE_WS_SHELL_FLUSH_MS;
+		kick = true;
+	}
+
+	memcpy(&ctx->tx_buf[ctx->tx_len], data, *cnt);
+	ctx->tx_len += *cnt;
+
+	/* The shell pends until TX_RDY when not everything was taken */
+	if (ctx->tx_len == sizeof(ctx->tx_buf)) {
+		ctx->tx_full = true;
+		kick = true;
+	}
+
+	k_spin_unlock(&ctx->tx_lock, key);
+
+	if (kick) {
+		ws_shell_kick();
+	}
+
+	return 0;
+}
+
+static int ws_shell_transport_read(const struct shell_transport *transport, void *data,
+				   size_t length, size_t *cnt)
+{
+	struct ws_shell_ctx *ctx = transport->ctx;
+
+	*cnt = ring_buf_get(&ctx->rx_ring, data, length);
+
+	return 0;
+}
+
+static const struct shell_transport_api ws_shell_transport_api = {
+	.init = ws_shell_transport_init,
+	.uninit = ws_shell_transport_uninit,
+	.enable = ws_shell_transport_enable,
+	.write = ws_shell_transport_write,
+	.read = ws_shell_transport_read,
+};
+
+#define WS_SHELL_DEFINE(n, _)							\
+	static struct ws_shell_ctx ws_shell_ctx_##n;				\
+	static const struct shell_transport ws_shell_transport_##n = {		\
+		.api = &ws_shell_transport_api,					\
+		.ctx = &ws_shell_ctx_##n,					\
+	};									\
+	SHELL_DEFINE(ws_shell_##n, CONFIG_NET_SAMPLE_WS_SHELL_PROMPT,		\
+		     &ws_shell_transport_##n, WS_SHELL_LOG_QUEUE_SIZE,		\
+		     WS_SHELL_LOG_TIMEOUT, SHELL_FLAG_OLF_CRLF);
+
+LISTIFY(CONFIG_NET_SAMPLE_WS_SHELL_SESSIONS, WS_SHELL_DEFINE, ())
+
+#define WS_SHELL_REF(n, _) &ws_shell_##n
+
+static const struct shell *const ws_shells[] = {
+	LISTIFY(CONFIG_NET_SAMPLE_WS_SHELL_SESSIONS, WS_SHELL_REF, (,))
+};
+
+#define WS_SHELL_CTX(i) ((struct ws_shell_ctx *)ws_shells[i]->iface->ctx)
+
+/* Hand typed input to the shell, answering pings on the way */
+static int ws_shell_rx(struct ws_shell_ctx *ctx)
+{
+	uint8_t buf[WS_SHELL_RX_CHUNK];
+	uint32_t message_type;
+	uint64_t remaining;
+	uint32_t put;
+	int ret;
+
+	while (true) {
+		ret = websocket_recv_msg(ctx->sock, buf, sizeof(buf), &message_type, &remaining, 0);
+		if (ret == -EAGAIN) {
+			return 0;
+		} else if (ret < 0) {
+			return ret;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_CLOSE) {
+			return -ECONNRESET;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_PING) {
+			ret = websocket_send_msg(ctx->sock, buf, ret, WEBSOCKET_OPCODE_PONG, false,
+						 true, CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+			if (ret < 0) {
+				return ret;
+			}
+
+			continue;
+		}
+
+		if (message_type & WEBSOCKET_FLAG_PONG) {
+			continue;
+		}
+
+		put = ring_buf_put(&ctx->rx_ring, buf, ret);
+		atomic_add(&ws_shell_rx_bytes, put);
+		if (put < ret) {
+			atomic_add(&ws_shell_rx_dropped, ret - put);
+		}
+
+		ctx->handler(SHELL_TRANSPORT_EVT_RX_RDY, ctx->handler_ctx);
+	}
+}
+
+/* Send the gathered output once it is due, otherwise lower timeout to the
+ * milliseconds left until it is.
+ */
+static int ws_shell_flush(struct ws_shell_ctx *ctx, int *timeout)
+{
+	static uint8_t APP_CCM_NOINIT frame[CONFIG_NET_SAMPLE_WS_SHELL_TX_BUF];
+	k_spinlock_key_t key;
+	int64_t due;
+	size_t len;
+	bool full;
+	int ret;
+
+	key = k_spin_lock(&ctx->tx_lock);
+
+	due = ctx->tx_deadline - k_uptime_get();
+	if (ctx->tx_len == 0 || (!ctx->tx_full && due > 0)) {
+		if (ctx->tx_len > 0) {
+			*timeout = (*timeout < 0) ? due : MIN(*timeout, due);
+		}
+
+		k_spin_unlock(&ctx->tx_lock, key);
+		return 0;
+	}
+
+	/* The shell keeps writing into tx_buf while the copy goes out */
+	len = ctx->tx_len;
+	full = ctx->tx_full;
+	memcpy(frame, ctx->tx_buf, len);
+	ctx->tx_len = 0;
+	ctx->tx_full = false;
+
+	k_spin_unlock(&ctx->tx_lock, key);
+
+	if (full) {
+		ctx->handler(SHELL_TRANSPORT_EVT_TX_RDY, ctx->handler_ctx);
+	}
+
+	/* Output may split multi-byte characters, so it goes as binary. This
+	 * thread serves every shell session, a client that does not take its
+	 * output within the send timeout is detached rather than waited for.
+	 */
+	ret = websocket_send_msg(ctx->sock, frame, len, WEBSOCKET_OPCODE_DATA_BINARY, false, true,
+				 CONFIG_NET_SAMPLE_WEBSOCKET_SEND_TIMEOUT);
+	if (ret < 0) {
+		return ret;
+	}
+
+	atomic_add(&ws_shell_tx_bytes, len);
+	atomic_inc(&ws_shell_tx_frames);
+
+	return 0;
+}
+
+static void ws_shell_detach(struct ws_shell_ctx *ctx)
+{
+	k_spinlock_key_t key;
+
+	(void)websocket_unregister(ctx->sock);
+	ctx->sock = -1;
+
+	/* Release a shell waiting for room that will never be made */
+	key = k_spin_lock(&ctx->tx_lock);
+	ctx->tx_len = 0;
+	ctx->tx_full = false;
+	k_spin_unlock(&ctx->tx_lock, key);
+
+	ctx->handler(SHELL_TRANSPORT_EVT_TX_RDY, ctx->handler_ctx);
+
+	atomic_dec(&ws_shell_sessions);
+	atomic_clear(&ctx->busy);
+}
+
+/* One thread serves the sockets of all shell sessions, sleeping in poll()
+ * until a client sends input, a session is attached or output is due.
+ */
+static void ws_shell_thread(void *p1, void *p2, void *p3)
+{
+	struct pollfd fds[CONFIG_NET_SAMPLE_WS_SHELL_SESSIONS + 1];
+	struct ws_shell_ctx *polled[CONFIG_NET_SAMPLE_WS_SHELL_SESSIONS];
+	struct ws_shell_ctx *ctx;
+	eventfd_t value;
+	int timeout;
+	int count;
+	int ret;
+
+	ws_shell_fd = eventfd(0, EFD_NONBLOCK);
+	if (ws_shell_fd < 0) {
+		LOG_ERR("Failed to create shell eventfd, err %d", errno);
+		return;
+	}
+
+	fds[0].fd = ws_shell_fd;
+	fds[0].events = POLLIN;
+	timeout = -1;
+
+	while (true) {
+		count = 0;
+		for (int i = 0; i < ARRAY_SIZE(ws_shells); i++) {
+			ctx = WS_SHELL_CTX(i);
+			if (ctx->sock < 0) {
+				continue;
+			}
+
+			polled[count] = ctx;
+			fds[count + 1].fd = ctx->sock;
+			fds[count + 1].events = POLLIN;
+			fds[count + 1].revents = 0;
+			count++;
+		}
+
+		ret = poll(fds, count + 1, timeout);
+		if (ret < 0) {
+			LOG_ERR("Error in poll:%d", errno);
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			(void)eventfd_read(ws_shell_fd, &value);
+		}
+
+		timeout = -1;
+		for (int i = 0; i < count; i++) {
+			ctx = polled[i];
+
+			if (fds[i + 1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+				ret = -ENOTCONN;
+			} else if (fds[i + 1].revents & POLLIN) {
+				ret = ws_shell_rx(ctx);
+			} else {
+				ret = 0;
+			}
+
+			if (ret == 0) {
+				ret = ws_shell_flush(ctx, &timeout);
+			}
+
+			if (ret < 0) {
+				LOG_INF("Shell client went away (%d), closing connection", ret);
+				ws_shell_detach(ctx);
+			}
+		}
+	}
+}
+
+APP_CCM_STACK_DEFINE(ws_shell_stack, WS_SHELL_STACK_SIZE);
+static struct k_thread ws_shell_thread_data;
+
+static int ws_shell_init(void)
+{
+	struct shell_backend_config_flags cfg_flags = SHELL_DEFAULT_BACKEND_CONFIG_FLAGS;
+	int ret;
+
+	for (int i = 0; i < ARRAY_SIZE(ws_shells); i++) {
+		WS_SHELL_CTX(i)->sock = -1;
+	}
+
+	k_thread_create(&ws_shell_thread_data, ws_shell_stack,
+			K_KERNEL_STACK_SIZEOF(ws_shell_stack), ws_shell_thread, NULL, NULL, NULL,
+			THREAD_PRIORITY, 0, K_NO_WAIT);
+
+	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+		k_thread_name_set(&ws_shell_thread_data, "ws_shell");
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(ws_shells); i++) {
+		ret = shell_init(ws_shells[i], NULL, cfg_flags, false, 0);
+		if (ret < 0) {
+			LOG_ERR("Failed to start websocket shell %d, err %d", i, ret);
+		}
+	}
+
+	return 0;
+}
+STARTUP_TASK_DEFINE(ws_shell, STARTUP_WS_SHELL, 0, ws_shell_init);
+
+int ws_shell_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data)
+{
+	struct ws_shell_ctx *ctx;
+
+	/* A shell runs any command, so the upgrade needs the bearer token */
+	if (!http_auth_bearer_ok(request_ctx)) {
+		LOG_WRN("Refusing websocket shell without a valid token");
+		atomic_inc(&ws_shell_rejected);
+		return -EACCES;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(ws_shells); i++) {
+		ctx = WS_SHELL_CTX(i);
+		if (!atomic_cas(&ctx->busy, 0, 1)) {
+			continue;
+		}
+
+		ctx->sock = ws_socket;
+		atomic_inc(&ws_shell_sessions);
+		ws_shell_kick();
+
+		LOG_INF("[%d] Accepted websocket shell connection", i);
+		return 0;
+	}
+
+	LOG_ERR("Cannot accept more websocket shell connections");
+	atomic_inc(&ws_shell_rejected);
+
+	/* The caller will close the connection in this case */
+	return -ENOENT;
+}
+
+static int ws_shell_stats_handler(struct http_client_ctx *client, enum http_data_status status,
+				  const struct http_request_ctx *request_ctx,
+				  struct http_response_ctx *response_ctx,
+				  const struct route_params *params)
+{
+	static char json_buf[192];
+	int ret;
+
+	if (status != HTTP_SERVER_DATA_FINAL) {
+		return 0;
+	}
+
+	ret = snprintf(json_buf, sizeof(json_buf),
+		       "{"
+		       "\"sessions\":%u,"
+		       "\"max\":%u,"
+		       "\"rejected\":%u,"
+		       "\"rx_bytes\":%u,"
+		       "\"rx_dropped\":%u,"
+		       "\"tx_bytes\":%u,"
+		       "\"tx_frames\":%u"
+		       "}",
+		       (uint32_t)atomic_get(&ws_shell_sessions),
+		       CONFIG_NET_SAMPLE_WS_SHELL_SESSIONS,
+		       (uint32_t)atomic_get(&ws_shell_rejected),
+		       (uint32_t)atomic_get(&ws_shell_rx_bytes),
+		       (uint32_t)atomic_get(&ws_shell_rx_dropped),
+		       (uint32_t)atomic_get(&ws_shell_tx_bytes),
+		       (uint32_t)atomic_get(&ws_shell_tx_frames));
+	if (ret >= sizeof(json_buf)) {
+		return -ENOSPC;
+	}
+
+	response_ctx->body = (const uint8_t *)json_buf;
+	response_ctx->body_len = ret;
+	response_ctx->final_chunk = true;
+
+	return 0;
+}
+
+ROUTE_DEFINE(ws_shell_stats_route, "/stats/shell", BIT(HTTP_GET), ws_shell_stats_handler);
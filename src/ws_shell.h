@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024, Witekio
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_WS_SHELL_H_
+#define APP_WS_SHELL_H_
+
+#include <zephyr/net/http/server.h>
+
+/*
+ * Each websocket client gets a shell instance of its own. Client data
+ * messages are fed to the shell as typed input, shell output comes back as
+ * binary messages. The shell prints its prompt once it gets a first line,
+ * so clients send "\r" after connecting.
+ */
+
+/**
+ * @brief Setup websocket for a remote shell session
+ *
+ * @param ws_socket Socket file descriptor associated with websocket
+ * @param request_ctx Request context associated with websocket HTTP upgrade request
+ * @param user_data User data pointer
+ *
+ * @return 0 on success, -ENOENT if all shell instances are in use
+ */
+int ws_shell_setup(int ws_socket, struct http_request_ctx *request_ctx, void *user_data);
+
+#endif /* APP_WS_SHELL_H_ */